@@ -0,0 +1,442 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#include "Cluster.h"
+#include "Random.h"
+using namespace std;
+
+// End-to-end scaling benchmark
+//
+//   benchmark.out [--scenarios small,dense,sparse,dieoff] [--threads 0,1,4]
+//                 [--steps <n>] [--scale <f>]
+//                 [--baseline <file>] [--write-baseline <file>]
+//                 [--threshold <f>] [--rss-threshold <f>]
+//
+// Runs fixed-seed scenarios through Cluster::step without any file output
+// and reports steps/s, agent updates/s (bacteria stepped), voxel updates/s
+// (patches diffused), peak RSS and the speedup over the first thread count
+// of the list. The default list is 0 (the tiles run one after another, as
+// main.out does by default, see Cluster::setThreads), 1 and every hardware
+// thread, speedups are relative to 0. --scale shrinks the grid edges by f
+// and the populations by f^3 for quick runs.
+//
+// With --baseline every rate that falls more than threshold (default 0.10)
+// below the baseline, or a peak RSS more than rss-threshold (default 0.25)
+// above it, is reported and the exit code is 1. --write-baseline stores
+// the results of this run in the same format.
+//
+// Each (scenario, threads) pair runs in a child process (benchmark.out
+// re-executed with the hidden --child flag, which prints one result line),
+// so its peak RSS is its own and not that of an earlier, larger scenario.
+// Without fork/exec (Windows) the pairs run in process and RSS is not
+// reported.
+
+struct scenario
+{
+    string name;
+    vector<int> gridSize;
+    int numBacteria;
+    double nutrientValue;           // initial nutrient per patch
+    unsigned long int steps;
+};
+
+struct result
+{
+    string scenario;
+    unsigned int threads = 0;
+    unsigned long int steps = 0;
+    double setupSeconds = 0.0, stepsPerSecond = 0.0,
+           agentUpdatesPerSecond = 0.0, voxelUpdatesPerSecond = 0.0,
+           peakRSS = 0.0;           // MB
+};
+
+// gives the benchmark the protected step()
+class BenchmarkCluster : public Cluster
+{
+
+public:
+    using Cluster::Cluster;
+
+    // runs up to steps steps, stops when every bacterium has died
+    unsigned long int advance(unsigned long int steps,
+                              unsigned long int& agentUpdates)
+    {
+        unsigned long int taken = 0;
+        for (; taken < steps && totalAliveBacteria > 0; taken++){
+            agentUpdates += totalAliveBacteria;
+            step();
+        }
+        return taken;
+    }
+};
+
+static double peakRSS()
+{
+#ifdef _WIN32
+    return 0.0;
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+static string toLine(const result& r)
+{
+    ostringstream line;
+    line << setprecision(10) << r.scenario << "," << r.threads << ","
+         << r.steps << "," << r.setupSeconds << "," << r.stepsPerSecond << ","
+         << r.agentUpdatesPerSecond << "," << r.voxelUpdatesPerSecond << ","
+         << r.peakRSS;
+    return line.str();
+}
+
+static vector<string> split(const string& list)
+{
+    vector<string> items;
+    stringstream stream(list);
+    string item;
+    while (getline(stream, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+static result measure(const scenario& s, unsigned int threads)
+{
+    typedef chrono::steady_clock clock;
+    RandomGenerator::setSeed(42);
+
+    result r;
+    r.scenario = s.name;
+    r.threads = threads;
+
+    const auto start = clock::now();
+    BenchmarkCluster cluster(s.numBacteria, 1, 300.0f, s.gridSize,
+                             s.nutrientValue);
+    cluster.setThreads(threads);
+    const auto ready = clock::now();
+
+    unsigned long int agentUpdates = 0;
+    r.steps = cluster.advance(s.steps, agentUpdates);
+    const auto end = clock::now();
+
+    const double seconds = chrono::duration<double>(end - ready).count();
+    const double voxels = double(s.gridSize[0]) * s.gridSize[1] * s.gridSize[2];
+
+    r.setupSeconds = chrono::duration<double>(ready - start).count();
+    if (seconds > 0){
+        r.stepsPerSecond = r.steps / seconds;
+        r.agentUpdatesPerSecond = agentUpdates / seconds;
+        r.voxelUpdatesPerSecond = voxels * r.steps / seconds;
+    }
+    r.peakRSS = peakRSS();
+    return r;
+}
+
+static result fromLine(const string& line)
+{
+    vector<string> fields = split(line);
+    if (fields.size() != 8)
+        throw runtime_error("Error: malformed child result : " + line);
+
+    result r;
+    r.scenario = fields[0];
+    r.threads = stoul(fields[1]);
+    r.steps = stoul(fields[2]);
+    r.setupSeconds = stod(fields[3]);
+    r.stepsPerSecond = stod(fields[4]);
+    r.agentUpdatesPerSecond = stod(fields[5]);
+    r.voxelUpdatesPerSecond = stod(fields[6]);
+    r.peakRSS = stod(fields[7]);
+    return r;
+}
+
+// runs one pair in a fresh benchmark.out and reads back its result line
+static result measureInChild(const char* program, const scenario& s,
+                             unsigned int threads, double scale)
+{
+#ifdef _WIN32
+    (void)program;
+    (void)scale;
+    return measure(s, threads);
+#else
+    ostringstream scaleText;
+    scaleText << setprecision(17) << scale;
+    vector<string> args = {program, "--child", "--scenarios", s.name,
+                           "--threads", to_string(threads),
+                           "--steps", to_string(s.steps),
+                           "--scale", scaleText.str()};
+    vector<char*> argv;
+    for (string& arg : args)
+        argv.push_back(&arg[0]);
+    argv.push_back(nullptr);
+
+    int channel[2];
+    if (pipe(channel) != 0)
+        throw runtime_error("Error: could not create a pipe for " + s.name);
+
+    cout << flush;
+    pid_t child = fork();
+    if (child < 0)
+        throw runtime_error("Error: could not fork for " + s.name);
+    if (child == 0){
+        close(channel[0]);
+        dup2(channel[1], STDOUT_FILENO);
+        close(channel[1]);
+        execvp(program, argv.data());
+        _exit(127);
+    }
+
+    close(channel[1]);
+    string output;
+    char buffer[4096];
+    ssize_t got;
+    while ((got = read(channel[0], buffer, sizeof(buffer))) > 0)
+        output.append(buffer, got);
+    close(channel[0]);
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        throw runtime_error("Error: " + s.name + " with " + to_string(threads)
+                            + " threads failed in its child process");
+
+    // the result is the last line the child printed
+    while (!output.empty() && output.back() == '\n')
+        output.pop_back();
+    return fromLine(output.substr(output.rfind('\n') + 1));
+#endif
+}
+
+static void writeBaseline(const string& filename, const vector<result>& results)
+{
+    ofstream file(filename);
+    if (!file.is_open())
+        throw runtime_error("Could not open " + filename + " for writing.");
+
+    file << "Scenario,Threads,StepsPerSecond,AgentUpdatesPerSecond,"
+            "VoxelUpdatesPerSecond,PeakRSSMB\n";
+    file << setprecision(10);
+    for (const result& r : results)
+        file << r.scenario << "," << r.threads << "," << r.stepsPerSecond
+             << "," << r.agentUpdatesPerSecond << ","
+             << r.voxelUpdatesPerSecond << "," << r.peakRSS << "\n";
+}
+
+static map<pair<string, unsigned int>, result> readBaseline(const string& filename)
+{
+    ifstream file(filename);
+    if (!file.is_open())
+        throw runtime_error("Could not open " + filename + " for reading.");
+
+    map<pair<string, unsigned int>, result> baseline;
+    string line;
+    getline(file, line);            // header
+    while (getline(file, line)){
+        vector<string> fields = split(line);
+        if (fields.size() != 6)
+            throw runtime_error("Error: malformed baseline line : " + line);
+
+        result r;
+        r.scenario = fields[0];
+        r.threads = stoul(fields[1]);
+        r.stepsPerSecond = stod(fields[2]);
+        r.agentUpdatesPerSecond = stod(fields[3]);
+        r.voxelUpdatesPerSecond = stod(fields[4]);
+        r.peakRSS = stod(fields[5]);
+        baseline[{r.scenario, r.threads}] = r;
+    }
+    return baseline;
+}
+
+// prints every metric that regressed, returns how many did
+static int compare(const vector<result>& results,
+                   const map<pair<string, unsigned int>, result>& baseline,
+                   double threshold, double rssThreshold)
+{
+    int regressions = 0;
+    auto check = [&](const result& r, const string& metric, double current,
+                     double reference, bool higherIsBetter){
+        if (reference <= 0)
+            return;
+        const double ratio = current / reference;
+        const bool failed = higherIsBetter ? ratio < 1.0 - threshold
+                                           : ratio > 1.0 + rssThreshold;
+        cout << (failed ? "REGRESSION " : "ok         ") << setw(8)
+             << r.scenario << " threads " << setw(2) << r.threads << "  "
+             << setw(22) << left << metric << right << fixed
+             << setprecision(3) << ratio << " x baseline\n";
+        if (failed)
+            regressions++;
+    };
+
+    for (const result& r : results){
+        auto match = baseline.find({r.scenario, r.threads});
+        if (match == baseline.end()){
+            cout << "no baseline for " << r.scenario << " with " << r.threads
+                 << " threads\n";
+            continue;
+        }
+        const result& b = match->second;
+        check(r, "steps/s", r.stepsPerSecond, b.stepsPerSecond, true);
+        check(r, "agent updates/s", r.agentUpdatesPerSecond,
+              b.agentUpdatesPerSecond, true);
+        check(r, "voxel updates/s", r.voxelUpdatesPerSecond,
+              b.voxelUpdatesPerSecond, true);
+        check(r, "peak RSS", r.peakRSS, b.peakRSS, false);
+    }
+    return regressions;
+}
+
+int main(int argc, char* argv[])
+{
+    vector<scenario> scenarios = {
+        {"small",  {50, 50, 50},    100,     1.0f, 500},
+        {"dieoff", {64, 64, 64},    100000,  0.0f, 200},    // starved
+        {"dense",  {128, 128, 128}, 1000000, 1.0f, 20},
+        {"sparse", {512, 512, 512}, 10000,   1.0f, 5},
+    };
+
+    vector<string> selected;
+    vector<unsigned int> threadCounts = {0, 1};
+    const unsigned int hardware = thread::hardware_concurrency();
+    if (hardware > 1)
+        threadCounts.push_back(hardware);
+
+    unsigned long int steps = 0;
+    double scale = 1.0, threshold = 0.10, rssThreshold = 0.25;
+    string baselineFile, outputFile;
+    bool child = false;
+
+    try{
+        for (int i = 1; i < argc; i++){
+            string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--scenarios" && hasValue)
+                selected = split(argv[++i]);
+            else if (arg == "--threads" && hasValue){
+                threadCounts.clear();
+                for (const string& count : split(argv[++i]))
+                    threadCounts.push_back(stoul(count));
+            }
+            else if (arg == "--steps" && hasValue)
+                steps = stoul(argv[++i]);
+            else if (arg == "--scale" && hasValue)
+                scale = stod(argv[++i]);
+            else if (arg == "--baseline" && hasValue)
+                baselineFile = argv[++i];
+            else if (arg == "--write-baseline" && hasValue)
+                outputFile = argv[++i];
+            else if (arg == "--threshold" && hasValue)
+                threshold = stod(argv[++i]);
+            else if (arg == "--rss-threshold" && hasValue)
+                rssThreshold = stod(argv[++i]);
+            else if (arg == "--child")
+                child = true;
+            else
+                throw invalid_argument("Error: unknown argument " + arg);
+        }
+        if (threadCounts.empty() || scale <= 0)
+            throw invalid_argument("Error: needs a thread count and a positive scale.");
+    }
+    catch (const exception& error){
+        cout << error.what() << "\n"
+             << "usage: benchmark.out [--scenarios small,dense,sparse,dieoff]"
+                " [--threads 0,1,4]\n"
+             << "                     [--steps <n>] [--scale <f>]"
+                " [--baseline <file>] [--write-baseline <file>]\n"
+             << "                     [--threshold <f>] [--rss-threshold <f>]\n";
+        return 2;
+    }
+
+    for (scenario& s : scenarios){
+        for (int& edge : s.gridSize)
+            edge = max(8, (int)lround(edge * scale));
+        s.numBacteria = max(1, (int)lround(s.numBacteria * scale * scale * scale));
+        if (steps > 0)
+            s.steps = steps;
+    }
+
+    // one pair for the parent process, see measureInChild
+    if (child){
+        for (const scenario& s : scenarios)
+            if (selected.size() == 1 && s.name == selected[0] &&
+                threadCounts.size() == 1){
+                cout << toLine(measure(s, threadCounts[0])) << endl;
+                return 0;
+            }
+        cout << "Error: --child needs one known scenario and one thread count\n";
+        return 2;
+    }
+
+    cout << left << setw(8) << "Scenario" << right << setw(8) << "Threads"
+         << setw(7) << "Steps" << setw(10) << "Setup s" << setw(11) << "Steps/s"
+         << setw(14) << "Agents/s" << setw(14) << "Voxels/s"
+         << setw(10) << "RSS MB" << setw(9) << "Speedup" << "\n";
+
+    vector<result> results;
+    try{
+        for (const scenario& s : scenarios){
+            if (!selected.empty() &&
+                find(selected.begin(), selected.end(), s.name) == selected.end())
+                continue;
+
+            double reference = 0.0;
+            for (unsigned int threads : threadCounts){
+                result r = measureInChild(argv[0], s, threads, scale);
+                if (reference == 0.0)
+                    reference = r.stepsPerSecond;
+
+                cout << left << setw(8) << r.scenario << right << setw(8)
+                     << r.threads << setw(7) << r.steps << fixed
+                     << setprecision(2) << setw(10) << r.setupSeconds
+                     << setw(11) << r.stepsPerSecond << scientific
+                     << setprecision(3) << setw(14) << r.agentUpdatesPerSecond
+                     << setw(14) << r.voxelUpdatesPerSecond << fixed
+                     << setprecision(1) << setw(10) << r.peakRSS
+                     << setprecision(2) << setw(9)
+                     << (reference > 0 ? r.stepsPerSecond / reference : 0.0)
+                     << "\n" << flush;
+                results.push_back(r);
+            }
+        }
+
+        if (!outputFile.empty())
+            writeBaseline(outputFile, results);
+
+        if (!baselineFile.empty()){
+            int regressions = compare(results, readBaseline(baselineFile),
+                                      threshold, rssThreshold);
+            if (regressions > 0){
+                cout << regressions << " regression(s) against "
+                     << baselineFile << endl;
+                return 1;
+            }
+        }
+    }
+    catch (const exception& error){
+        cout << "Error : " << error.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
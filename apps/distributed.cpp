@@ -0,0 +1,66 @@
+#include <mpi.h>
+#include <stdexcept>
+#include <string>
+#include <iostream>
+#include "DistributedCluster.h"
+#include "Random.h"
+using namespace std;
+
+// Runs the simulation split over MPI ranks, e.g.
+//   mpirun -np 4 ./distributed.out [seed] [--threads <n>]
+
+int main(int argc, char* argv[])
+{
+    MPI_Init(&argc, &argv);
+
+    int rank = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // A seed makes the run reproducible - for any number of ranks it is
+    // the run of main.out with that seed. --threads runs the tiles of each
+    // rank on n threads. The other options of main.out are rejected, their
+    // output is not distributed
+    unsigned int threads = 0;
+    try{
+        for (int i = 1; i < argc; i++){
+            string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--threads" && hasValue)
+                threads = stoul(argv[++i]);
+            else if (arg == "--live" || arg == "--export" ||
+                     arg == "--death-log" || arg == "--plot" ||
+                     arg == "--chemotaxis")
+                throw invalid_argument("Error: " + arg + " is not supported "
+                                       "in distributed mode.");
+            else if (arg.find_first_not_of("0123456789") == string::npos)
+                RandomGenerator::setSeed(stoul(arg));
+            else
+                throw invalid_argument("Error: unknown argument " + arg);
+        }
+    }
+    catch (const exception& error){
+        if (rank == 0)
+            cout << error.what() << "\n"
+                 << "usage: distributed.out [seed] [--threads <n>]\n";
+        MPI_Finalize();
+        return 2;
+    }
+
+    // Output filename
+    string filename = "distributed.csv";
+
+    int return_code = 0;
+    try{
+        DistributedCluster cottonBed(MPI_COMM_WORLD, 100);
+        cottonBed.setThreads(threads);
+        cottonBed.run(filename);
+    }
+    catch (const exception& error){
+        cout << "Error : " << error.what() << endl;
+        return_code = 1;
+        MPI_Abort(MPI_COMM_WORLD, return_code);
+    }
+
+    MPI_Finalize();
+    return return_code;
+}
@@ -0,0 +1,137 @@
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <iostream>
+#include "Cluster.h"
+#include "GoldenTrace.h"
+#include "Random.h"
+#ifdef WITH_MPI
+#include <mpi.h>
+#include "DistributedCluster.h"
+#endif
+using namespace std;
+
+// Golden-run regression checker
+//
+//   golden.out record <trace> [steps] [seed] [numBacteria] [--distributed]
+//       runs a deterministic simulation and stores its per-step state
+//   golden.out check <trace> [tolerance] [--distributed]
+//       replays the run stored in <trace> with this build and reports the
+//       first step where the two diverge
+//
+// With --distributed (builds with MPI only) the run is a DistributedCluster
+// over the ranks of mpirun, e.g. mpirun -np 4 golden.out check <trace> 0
+// --distributed. Rank 0 reports.
+
+int usage()
+{
+    cout << "usage: golden.out record <trace> [steps] [seed] [numBacteria]"
+            " [--distributed]\n"
+         << "       golden.out check <trace> [tolerance] [--distributed]\n";
+    return 2;
+}
+
+GoldenTrace replay(unsigned int seed, int numBacteria, unsigned long steps,
+                   bool distributed)
+{
+    RandomGenerator::setSeed(seed);
+
+    GoldenTrace trace;
+    trace.seed = seed;
+    trace.numBacteria = numBacteria;
+
+#ifdef WITH_MPI
+    if (distributed){
+        DistributedCluster cottonBed(MPI_COMM_WORLD, numBacteria);
+        cottonBed.simulate(steps, &trace);
+        return trace;
+    }
+#endif
+    Cluster cottonBed(numBacteria);
+    cottonBed.simulate(steps, &trace);
+    return trace;
+}
+
+// only the reporting process prints and writes the trace
+int run(int argc, char* argv[], bool distributed, bool report)
+{
+    if (argc < 3)
+        return report ? usage() : 2;
+
+    string mode = argv[1];
+    string traceFile = argv[2];
+
+    if (mode == "record"){
+        unsigned long steps = argc > 3 ? stoul(argv[3]) : 200;
+        unsigned int seed = argc > 4 ? stoul(argv[4]) : 42;
+        int numBacteria = argc > 5 ? stoi(argv[5]) : 100;
+
+        GoldenTrace trace = replay(seed, numBacteria, steps, distributed);
+        if (!report)
+            return 0;
+        trace.write(traceFile);
+        cout << "Recorded " << trace.steps.size() << " steps to "
+             << traceFile << endl;
+        return 0;
+    }
+
+    if (mode == "check"){
+        double tolerance = argc > 3 ? stod(argv[3]) : 0.0;
+
+        GoldenTrace golden = GoldenTrace::read(traceFile);
+        GoldenTrace current = replay(golden.seed, golden.numBacteria,
+                                     golden.steps.size(), distributed);
+        if (!report)
+            return 0;
+
+        string what;
+        long int divergence = golden.firstDivergence(current, tolerance, what);
+        if (divergence < 0){
+            cout << "OK : " << golden.steps.size()
+                 << " steps match " << traceFile << endl;
+            return 0;
+        }
+
+        cout << "DIVERGED at step " << divergence + 1 << " (" << what
+             << ") with tolerance " << tolerance << endl;
+        return 1;
+    }
+
+    return report ? usage() : 2;
+}
+
+int main(int argc, char* argv[])
+{
+    // --distributed may come anywhere, the other arguments are positional
+    bool distributed = false;
+    int kept = 1;
+    for (int i = 1; i < argc; i++){
+        if (string(argv[i]) == "--distributed")
+            distributed = true;
+        else
+            argv[kept++] = argv[i];
+    }
+    argc = kept;
+
+    if (!distributed)
+        return run(argc, argv, false, true);
+
+#ifdef WITH_MPI
+    MPI_Init(&argc, &argv);
+    int rank = 0, code = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    try{
+        code = run(argc, argv, true, rank == 0);
+    }
+    catch (const exception& error){
+        cout << "Error : " << error.what() << endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Finalize();
+    return code;
+#else
+    cout << "Error: golden.out was built without MPI, --distributed is not "
+            "available." << endl;
+    return 2;
+#endif
+}
@@ -1,25 +1,84 @@
-#include <cstdlib>
-#include <string>
-#include <iostream>
-#include "Cluster.h"
-using namespace std;
-
-int main()
-{
-    // Output filename
-    string filename = "trial1.csv";
-
-    // Initialising environment and running simulations
-    Cluster cottonBed(100);             // initial number of bacteria
-    cottonBed.run(filename);    // inputs -name of output file
-
-    // Calling python script to plot graph
-    string command = "../utils/plot.py " + filename;
-    int return_code = system(command.c_str());
-    if (return_code != 0){
-        cout << "Python Code failed with exit code : " << return_code;
-        return return_code + 10;
-    }
-
-    return 0;
-}
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <iostream>
+#include "Cluster.h"
+#include "Random.h"
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+    // Arguments : [seed] [--live <name>] [--export <cadence>]
+    //             [--death-log <file>] [--threads <n>] [--plot]
+    //             [--chemotaxis <n>]
+    // A seed makes the run reproducible, --live publishes the frames to
+    // shared memory for "visualiser.py --live <name>", --export writes
+    // levels 0-2 of the field pyramid every <cadence> steps,
+    // --death-log records every death in a binary log, --threads runs
+    // the steps in tiles on n threads, --plot calls utils/plot.py on the
+    // CSV afterwards (the run summary is written either way) and
+    // --chemotaxis adds n bacteria of the chemotactic strain
+    string liveFeedName, deathLogName;
+    unsigned int threads = 0;
+    bool plot = false;
+    int chemotactic = 0;
+    ExportSettings fieldExport;
+    fieldExport.levels = {0, 1, 2};
+    try{
+        for (int i = 1; i < argc; i++){
+            string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--live" && hasValue)
+                liveFeedName = argv[++i];
+            else if (arg == "--export" && hasValue)
+                fieldExport.cadence = stoi(argv[++i]);
+            else if (arg == "--death-log" && hasValue)
+                deathLogName = argv[++i];
+            else if (arg == "--threads" && hasValue)
+                threads = stoul(argv[++i]);
+            else if (arg == "--plot")
+                plot = true;
+            else if (arg == "--chemotaxis" && hasValue)
+                chemotactic = stoi(argv[++i]);
+            else if (arg.find_first_not_of("0123456789") == string::npos)
+                RandomGenerator::setSeed(stoul(arg));
+            else
+                throw invalid_argument("Error: unknown argument " + arg);
+        }
+    }
+    catch (const exception& error){
+        cout << error.what() << "\n"
+             << "usage: main.out [seed] [--live <name>] [--export <cadence>]\n"
+             << "                [--death-log <file>] [--threads <n>] [--plot]\n"
+             << "                [--chemotaxis <n>]\n";
+        return 2;
+    }
+
+    // Output filename
+    string filename = "trial1.csv";
+
+    // Initialising environment and running simulations
+    Cluster cottonBed(100);             // initial number of bacteria
+    if (chemotactic > 0)
+        cottonBed.addStrain<ChemotacticStrain>(chemotactic);
+    cottonBed.setThreads(threads);
+    if (!liveFeedName.empty())
+        cottonBed.enableLiveFeed(liveFeedName);
+    cottonBed.setFieldExport(fieldExport);
+    if (!deathLogName.empty())
+        cottonBed.enableDeathLog(deathLogName);
+    cottonBed.run(filename);    // inputs -name of output file
+
+    if (!plot)
+        return 0;
+
+    // Calling python script to plot graph
+    string command = "../utils/plot.py " + filename;
+    int return_code = system(command.c_str());
+    if (return_code != 0){
+        cout << "Python Code failed with exit code : " << return_code;
+        return return_code + 10;
+    }
+
+    return 0;
+}
@@ -0,0 +1,66 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+
+// A fixed-capacity FIFO shared between one producer and one consumer
+// thread. push blocks while the queue is full, pop blocks while it is
+// empty, and close lets the consumer drain what is left and stop - or
+// lets a consumer that failed release the producer.
+template <typename T>
+class BoundedQueue
+{
+
+private:
+    std::deque<T> items;
+    std::size_t capacity;
+    bool closed = false;
+
+    std::mutex lock;
+    std::condition_variable notFull, notEmpty;
+
+public:
+    explicit BoundedQueue(std::size_t capacityValue = 8)
+        : capacity(capacityValue) {}
+
+    // returns false and drops the item once the queue is closed, so the
+    // producer is not left waiting on a consumer that stopped
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        notFull.wait(guard, [this]{ return items.size() < capacity || closed; });
+        if (closed)
+            return false;
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // returns false once the queue is closed and empty
+    bool pop(T& item)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        notEmpty.wait(guard, [this]{ return !items.empty() || closed; });
+        if (items.empty())
+            return false;
+
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+};
+
+#endif
@@ -1,49 +1,196 @@
-#ifndef CLUSTER_H
-#define CLUSTER_H
-
-#include "Environment.h"
-#include "Species.h"
-#include <string>
-
-class Cluster : public Environment, protected Bacterium
-{
-
-protected:
-    // A vector of bacterium which contains all alive members
-    vector<Bacterium> alive = {};
-    // A vector of bacterium which contains all dead members
-    vector<Bacterium> dead = {};
-
-    // values containing total values of bacteria
-    unsigned long int totalBacteria = 0;
-    unsigned long int totalAliveBacteria = 0;
-    unsigned long int totalDeadBacteria = 0;
-    
-    // Accessors 
-    std::pair<bool, unsigned long int> isPresent( Bacterium );
-    
-    // Mutators - functions to edit the members of the cluster
-    // add - registers the bacterium into the cluster
-    void add( Bacterium* );
-    void omit( Bacterium* );
-
-    void step();
-
-
-public:
-
-    // initializer
-    Cluster(int numBacteria = 100, int randomiseType = 1, 
-            double EnergyLevel = 300.0f);
-
-    void updateTemporalResolution(double tempRes);
-
-    // runs as long as all the bacteria does not die
-    void run(std::string filename);
-    // runs uptil a particular time speciefied or until all bacteia die
-    void run(std::string filename, double time);  
-
-};
-
-
-#endif
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include "Environment.h"
+#include "Species.h"
+#include "GoldenTrace.h"
+#include "LiveFeed.h"
+#include "FieldPyramid.h"
+#include "DeathLog.h"
+#include "Random.h"
+#include "TaskPool.h"
+#include "RunAnalytics.h"
+#include <functional>
+#include <memory>
+#include <string>
+
+class Cluster : public Environment, protected Bacterium
+{
+
+public:
+    // The alive members of one strain, with the kernel compiled for it
+    struct population
+    {
+        std::string strain;
+        Bacterium::kernel live;
+        int reach;                      // Bacterium::reach<Strain>()
+        vector<Bacterium> members;
+    };
+
+    // The members of one population grouped for a step. Tiles are xy
+    // squares of twice the largest reach over the whole chamber (extent),
+    // numbered x-major, so a tile is the same in every process of a
+    // DistributedCluster
+    struct tiling
+    {
+        int size = 0, tilesX = 0, tilesY = 0;
+        vector<std::size_t> first;              // tile t is [first[t], first[t + 1])
+        vector<vector<Bacterium>> births;       // per tile
+        vector<Bacterium::tally> totals;        // per tile
+    };
+
+protected:
+    // One population per strain, the standard strain seeded by the
+    // constructor comes first
+    vector<population> populations;
+    // Dead members are not kept, they are counted per patch in the
+    // Environment (recordDeath) and optionally written to a death log
+    std::unique_ptr<DeathLog> deathLog;
+    unsigned long int stepsTaken = 0;
+
+    // values containing total values of bacteria
+    unsigned long int totalBacteria = 0;
+    unsigned long int totalAliveBacteria = 0;
+    unsigned long int totalDeadBacteria = 0;
+
+    // optional shared-memory feed of the vis frames, and whether the vis
+    // frames also go to vis_data.csv
+    std::unique_ptr<LiveFeed> liveFeed;
+    bool writeVisFile = true;
+
+    // multi-resolution export of the nutrient and acetate fields
+    ExportSettings fieldExport;
+
+    // runs the tiles of a step and diffuse() when threads are set
+    std::unique_ptr<TaskPool> pool;
+
+    // streaming statistics of the last run()
+    RunAnalytics analytics;
+    
+    // Mutators - functions to edit the members of the cluster
+    // add - registers the bacterium into the cluster (its contents are moved)
+    void add( Bacterium*, std::size_t strain = 0 );
+    // adds a population running the given kernel, numBacteria of them
+    // placed at random
+    void addPopulation( const std::string& strain, Bacterium::kernel live,
+                        int reach, int numBacteria, double EnergyLevel );
+    // adds numBacteria at random positions to a population
+    void scatter( std::size_t strain, int numBacteria, double EnergyLevel );
+    // numBacteria at random patches of extent, with IDs from firstID on.
+    // They are drawn in parallel blocks, each from its own random stream
+    // of the run seed, so the result does not depend on the thread count
+    static vector<Bacterium> seedPopulation( int numBacteria,
+                                             double EnergyLevel,
+                                             const vector<int>& extent,
+                                             unsigned long int firstID,
+                                             unsigned int stream );
+    // removes every member that died during the last step
+    void removeDead();
+    // accounts for a member that died, the caller removes it from alive
+    void bury( Bacterium& );
+
+    virtual void step();
+    // sorts the members of a population by tile, and by ID within a tile
+    tiling binTiles( std::size_t strain );
+    // runs the tiles of one colour of a 2 x 2 pattern, see setThreads
+    void liveColour( std::size_t strain, tiling& , int colour );
+    // applies the totals of the tiles and moves their births to births,
+    // both in tile order
+    void applyTiles( tiling& , vector<Bacterium>& births );
+    // runs task(i) for every i in [0, count) on the pool, in order on this
+    // thread without one
+    void runTasks( std::size_t count,
+                   const std::function<void(std::size_t)>& task );
+
+public:
+    // Immutable copy of what the output needs from one step, handed from
+    // the simulation thread to the output threads in run()
+    struct snapshot
+    {
+        unsigned long int timeStep = 0;
+        double timeElapsed = 0.0f;
+        unsigned long int aliveBacteria = 0, totalBacteria = 0;
+        double CO2Level = 0.0f, nutrientLevel = 0.0f, acetateLevel = 0.0f;
+        vector<unsigned long int> aliveByStrain;        // one per population
+
+        // filled on vis frames only
+        bool hasFrame = false;
+        vector<double> nutrientSlice, acetateSlice;     // x-major slice
+        vector<int> alivePositions;                     // x,y pairs
+        vector<unsigned int> deathColumns;              // x-major, summed over z
+
+        // level 0 of the field pyramid as far as its view needs it, filled
+        // on field export steps only
+        bool hasFields = false;
+        FieldPyramid::level fields;
+        int firstPlane = 0;
+    };
+
+protected:
+    // fields is the pyramid of a field export step, nullptr otherwise
+    snapshot capture(unsigned long int timeStep, double timeElapsed,
+                     bool withFrame, const FieldPyramid* fields = nullptr);
+
+
+public:
+
+    // initializer
+    Cluster(int numBacteria = 100, int randomiseType = 1, 
+            double EnergyLevel = 300.0f, vector<int> gridSize = {50,50,50},
+            double nutrientValue = 1.0f);     // initial nutrient per patch
+    virtual ~Cluster() = default;
+
+    void updateTemporalResolution(double tempRes);
+
+    // adds numBacteria of another strain, placed at random. The strain
+    // needs a liveBlock instantiation in Species.cpp. With more than one
+    // strain the CSV of run() gets an alive count per strain
+    template <class Strain>
+    void addStrain(int numBacteria, double EnergyLevel = 300.0f)
+    {
+        // chemotactic strains read the gradients diffuse() keeps
+        if (Strain::chemotactic)
+            trackGradients = true;
+        addPopulation(Strain::name, &Bacterium::liveBlock<Strain>,
+                      Bacterium::reach<Strain>(), numBacteria, EnergyLevel);
+    }
+
+    // A step groups the bacteria by tile (see tiling) and runs the tiles
+    // colour by colour of a 2 x 2 pattern - tiles of one colour never
+    // share a patch - each bacterium from its own random stream, in ID
+    // order within its tile. With 0 (the default) the tiles run one after
+    // another, with threads > 0 as tasks of a work-stealing pool, which
+    // diffuse() also runs on. Seeded runs give the same result for any
+    // thread count, and for any number of ranks of a DistributedCluster
+    void setThreads(unsigned int threads);
+
+    // publishes the vis frames of run() to the shared memory segment
+    // /<name> for visualiser.py --live. vis_data.csv is then only written
+    // when keepVisFile is set
+    void enableLiveFeed(const std::string& name, bool keepVisFile = false);
+    // writes every death to a compact binary log, see DeathLog
+    void enableDeathLog(const std::string& filename);
+    // writes a pyramid of the fields during run(), see FieldPyramid
+    void setFieldExport(const ExportSettings& settings);
+
+    // runs as long as all the bacteria does not die
+    void run(std::string filename);
+    // runs uptil a particular time speciefied or until all bacteia die.
+    // Next to the CSV it writes <name>-summary.csv, see RunAnalytics
+    virtual void run(std::string filename, double time);
+    const RunAnalytics& getAnalytics() const;
+
+    // runs the given number of steps (or until all bacteria die) without
+    // writing any output, recording the state after each step into trace
+    // when one is given
+    virtual void simulate(unsigned long int steps,
+                          GoldenTrace* trace = nullptr);
+    // snapshot of the current state, labelled with the step number. The
+    // energy is summed in ID order, so it does not depend on how the
+    // bacteria are stored
+    virtual StepState state(unsigned long int step);
+
+};
+
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef DEATHLOG_H
+#define DEATHLOG_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include "Species.h"
+
+
+// Append-only binary log of deaths. Every death is one 20 byte record,
+// little endian:
+//
+//   0   uint64  bacteria ID
+//   8   uint32  step the bacterium died in
+//   12  int16   x, y, z position
+//   18  uint8   cause (Bacterium::deathCause)
+//   19  uint8   reserved, 0
+//
+// The file starts with the 8 byte magic "BIOSIMDL".
+class DeathLog
+{
+
+private:
+    std::ofstream file;
+
+public:
+    static const int recordBytes = 20;
+
+    explicit DeathLog(const std::string& filename);
+
+    void append(unsigned long int id, unsigned long int step,
+                const vector<int>& position, Bacterium::deathCause cause);
+};
+
+#endif
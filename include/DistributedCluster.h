@@ -0,0 +1,94 @@
+#ifndef DISTRIBUTEDCLUSTER_H
+#define DISTRIBUTEDCLUSTER_H
+
+#include <mpi.h>
+#include <string>
+#include "Cluster.h"
+
+
+// A Cluster spread over the processes of an MPI communicator. The chamber
+// is cut into slabs along x, every rank owns one slab and the bacteria in
+// it. Slabs are whole columns of the tiles of Cluster::step, so a tile is
+// never split between ranks. Each slab is padded with halo planes copied
+// from its neighbours, wide enough for a bacterium on the edge to move,
+// eat and sense acetate (movementSpeed + proximity planes, at least one
+// for diffuse()).
+//
+// A step runs as
+//   1. fill the halos from the owning ranks
+//   2. for each of the 4 tile colours, run the local tiles of the colour,
+//      hand the halo planes they changed to the owners and refresh the
+//      halos. Of the two tile columns at a slab border only one has the
+//      colour, so a border patch is only ever changed by one rank, on an
+//      up to date copy
+//   3. diffuse
+//   4. sum the per-tile totals over all ranks and apply them in tile order
+//   5. record the deaths, on the rank owning the patch, in the order
+//      Cluster::removeDead would
+//   6. register births with globally unique IDs in tile order, migrate
+//      bacteria that left the slab to the neighbouring rank
+// Every bacterium draws from its own keyed stream and the order of every
+// floating point sum is that of Cluster::step, so for any number of ranks
+// the run is bit for bit that of a Cluster with the same seed (golden.out
+// check --distributed compares them).
+// Only the standard strain is distributed - the halos are sized for it and
+// records do not carry a strain - so addStrain is not used here.
+class DistributedCluster : public Cluster
+{
+
+public:
+    // totals over all ranks
+    struct totals
+    {
+        unsigned long int aliveBacteria = 0, totalBacteria = 0;
+        long double nutrientLevel = 0.0f, acetateLevel = 0.0f;
+        double CO2Level = 0.0f;
+    };
+
+    DistributedCluster(MPI_Comm communicator, int numBacteria = 100,
+                       vector<int> gridSize = {50,50,50},
+                       double EnergyLevel = 300.0f);
+
+    totals reduce();
+
+    // same as Cluster::run, rank 0 writes the CSV and the summary of the
+    // global totals. The vis output, the live feed, the field export, the
+    // death log and other strains are not distributed, run throws
+    // invalid_argument when one of them is set
+    using Cluster::run;
+    void run(std::string filename, double maxTime) override;
+
+    // same as Cluster::simulate and Cluster::state over all ranks. Both
+    // have to be called on every rank, only the state on rank 0 is whole
+    void simulate(unsigned long int steps,
+                  GoldenTrace* trace = nullptr) override;
+    StepState state(unsigned long int step) override;
+
+protected:
+    MPI_Comm comm;
+    int rank = 0, ranks = 1;
+
+    vector<int> globalSize;
+    int ownedBegin = 0, ownedEnd = 0;       // global x range of this slab
+    int haloLow = 0, haloHigh = 0;          // halo planes below and above
+    unsigned long int nextID = 1;           // next free global ID
+
+    void step() override;
+
+    // copies planes [first, first + count) of the local grid in or out
+    void packPlanes(int first, int count, vector<double>& buffer) const;
+    void unpackPlanes(int first, int count, const vector<double>& buffer);
+
+    void exchangeHalos();
+    // hands the halo planes the tiles of one colour, with x parity
+    // parity, may have changed to their owners
+    void returnHalos(int parity);
+    // sums the per-tile totals of all ranks, only one rank has a tile
+    void reduceTiles(tiling& );
+    // records the deaths of the step and removes the dead, see step 5
+    void buryDead();
+    void registerBirths(vector<Bacterium>& births);
+    void migrate();
+};
+
+#endif
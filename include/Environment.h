@@ -1,70 +1,140 @@
-#ifndef ENVIRONMENT_H
-#define ENVIRONMENT_H
-
-#include <vector>
-using std::vector;
-
-class Environment
-{
-
-protected:
-    struct patch
-    {
-        double 
-            nutrientLevel = 0,          // amount of nutrient in a patch    
-            acetateLevel = 0;           // amount of acetate in a patch
-
-        patch();
-
-    };
-
-    vector<vector<vector<patch>>> locale; // main 3d distribution of patches
-
-    vector<vector<vector<patch>>> buffer; 
-		// a static buffer value to store a copy of the locale
-    vector<int> ranges; 
-
-    double CO2Level = 0.0f;
-    long double totalNutrientLevel = 0.0f; 
-    long double totalAcetateLevel = 0.0f;
-    double temporalResolution = 1.0f;         // units - seconds
-    double diffusionConstant = 1.0f;
-
-
-public:
-
-    // Initialiser
-    Environment( int randomiseType = 0, vector<int> = {50,50,50},
-                 double nutrientValue = 1.0f, double acetateValue = 0.0f, 
-                 double tempres = 1.0f);
-
-
-    // Mutators
-    void updateNutrient(const vector<int>& location, double nutrientChange);
-    // In src/Environment.cpp
-
-    void updateAcetate(const vector<int>& location, double acetateChange);
-    void updateCO2(double CO2Increase);
-    void updateTemporalResolution(const double tempresNew);
-    void diffuse();
-
-
-    // Accessors
-    // returns size of Environment
-    vector<int> getSize() const;
-    // nutrient level of patch
-    double getNutrientLevel(const vector<int>& ) const;
-    // nutrient level of entire environment
-    double getNutrientLevel() const;
-    // nutrient level of patch
-    double getAcetateLevel(const vector<int>& ) const;
-    // nutrient level of whole environment
-    double getAcetateLevel() const;
-    double getCO2Level();
-    double getTemporalResolution();
-    // In include/Environment.h
-    // In include/Environment.h
-    double consumeNutrient(const vector<int>& pos, double amount);
-};
-
-#endif
+#ifndef ENVIRONMENT_H
+#define ENVIRONMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Parallel.h"
+using std::vector;
+
+class TaskPool;
+
+class Environment
+{
+    // the batched agent kernel (Bacterium::liveBlock) works on the patches
+    // directly instead of going through the checked accessors
+    friend class Bacterium;
+
+protected:
+    // left uninitialised when the grid is allocated, the constructor fills
+    // the planes in parallel so each is first touched by its thread
+    struct patch
+    {
+        double 
+            nutrientLevel,              // amount of nutrient in a patch    
+            acetateLevel;               // amount of acetate in a patch
+    };
+
+    typedef vector<patch, firstTouchAllocator<patch>> grid;
+
+    grid locale; // main 3d distribution of patches, x-major then y then z
+
+    grid buffer; 
+		// next state of the grid in diffuse(), swapped with locale
+    // when set, diffuse() runs its planes as tasks of this pool
+    TaskPool* tasks = nullptr;
+
+    // size of the whole chamber. Bacteria stay inside it, it only differs
+    // from ranges when the environment is one subdomain
+    vector<int> extent;
+
+    // central differences of both fields per patch, in the same layout as
+    // locale. diffuse() fills them from the fields it diffuses when
+    // trackGradients is set, for chemotactic movement
+    struct gradient
+    {
+        float nutrient[3], acetate[3];
+    };
+    vector<gradient, firstTouchAllocator<gradient>> gradients;
+    bool trackGradients = false;
+    vector<int> ranges; 
+    // global position of patch (0,0,0). It is only non-zero when the
+    // environment holds one subdomain of a larger chamber, positions passed
+    // to the accessors are always global
+    vector<int> origin = {0,0,0};
+
+    // remains of dead bacteria per patch, x-major like copyFields. Both
+    // are allocated with the first death
+    vector<float> necromass;
+    vector<unsigned int> deathCount;
+    // deaths per xy column, summed over z, for the vis frames - kept by
+    // recordDeath so a frame does not scan the whole grid
+    vector<unsigned int> deathColumns;
+
+    double CO2Level = 0.0f;
+    long double totalNutrientLevel = 0.0f; 
+    long double totalAcetateLevel = 0.0f;
+    double temporalResolution = 1.0f;         // units - seconds
+    double diffusionConstant = 1.0f;
+
+    // position of a patch in locale and in the per-patch death fields
+    std::size_t index(int i, int j, int k) const
+    { return (std::size_t(i) * ranges[1] + j) * ranges[2] + k; }
+
+    // unchecked access to a patch, the caller has to do the bounds check
+    patch& cell(int i, int j, int k) { return locale[index(i, j, k)]; }
+    const patch& cell(int i, int j, int k) const
+    { return locale[index(i, j, k)]; }
+
+    // checksum() over count patches in the order given, for a grid
+    // gathered from the slabs of several processes
+    static uint64_t checksum(const patch* patches, std::size_t count,
+                             long double& nutrientSum, long double& acetateSum);
+
+
+public:
+
+    // Initialiser
+    Environment( int randomiseType = 0, vector<int> = {50,50,50},
+                 double nutrientValue = 1.0f, double acetateValue = 0.0f, 
+                 double tempres = 1.0f);
+
+
+    // Mutators
+    void updateNutrient(const vector<int>& location, double nutrientChange);
+    // In src/Environment.cpp
+
+    void updateAcetate(const vector<int>& location, double acetateChange);
+    void updateCO2(double CO2Increase);
+    void updateTemporalResolution(const double tempresNew);
+    void diffuse();
+    // registers a bacterium that died at location, leaving remains behind.
+    // Locations off the grid are put on the nearest patch
+    void recordDeath(const vector<int>& location, double remains);
+
+
+    // Accessors
+    // returns size of Environment
+    vector<int> getSize() const;
+    // returns global position of the first patch
+    vector<int> getOrigin() const;
+    // returns size of the whole chamber
+    vector<int> getExtent() const;
+    // nutrient level of patch
+    double getNutrientLevel(const vector<int>& ) const;
+    // nutrient level of entire environment
+    double getNutrientLevel() const;
+    // nutrient level of patch
+    double getAcetateLevel(const vector<int>& ) const;
+    // nutrient level of whole environment
+    double getAcetateLevel() const;
+    double getCO2Level();
+    // number of deaths and remains at a patch
+    unsigned int getDeathCount(const vector<int>& ) const;
+    double getNecromass(const vector<int>& ) const;
+    double getTemporalResolution();
+    // In include/Environment.h
+    // In include/Environment.h
+    double consumeNutrient(const vector<int>& pos, double amount);
+    // sums over the nutrient and acetate fields and a hash of their exact
+    // bits, used to check that two runs are identical
+    uint64_t checksum(long double& nutrientSum, long double& acetateSum) const;
+    // full-resolution copy of both fields in the z planes [firstPlane,
+    // firstPlane + planes), x-major then y then z. By default every plane
+    void copyFields(vector<float>& nutrient, vector<float>& acetate,
+                    int firstPlane = 0, int planes = -1) const;
+    // mean of both fields along z, x-major then y
+    void projectFields(vector<float>& nutrient, vector<float>& acetate) const;
+};
+
+#endif
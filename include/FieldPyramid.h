@@ -0,0 +1,78 @@
+#ifndef FIELDPYRAMID_H
+#define FIELDPYRAMID_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+using std::vector, std::string;
+
+
+// What the multi-resolution field export writes, and how often
+struct ExportSettings
+{
+    enum View
+    {
+        slice,          // one xy plane
+        projection,     // mean along z
+        volume          // every cell of the level
+    };
+
+    int cadence = 0;                // export every cadence steps, 0 = off
+    vector<int> levels = {0};       // pyramid levels to write, 0 = full size
+    View view = slice;
+    int zSlice = -1;                // plane at level 0, -1 = middle of grid
+    string basename = "../results/field";   // files are <basename>-L<n>.csv
+};
+
+
+// Mip pyramid of the nutrient and acetate fields. Level 0 is the grid
+// itself, every further level averages 2x2x2 blocks of the one below
+// (blocks cut off by an odd edge average over the cells they have).
+// Each selected level goes to its own CSV file, so a viewer can read a
+// coarse level quickly and only open the finer ones when needed.
+//
+// Only the part of level 0 the view needs is built: the planes under the
+// slice (see slab), the mean along z, or for the volume view the whole
+// grid. The projection of level n is therefore the 2^n x 2^n block
+// average of the full-resolution z-mean.
+class FieldPyramid
+{
+
+public:
+    struct level
+    {
+        int nx = 0, ny = 0, nz = 0;
+        vector<float> nutrient, acetate;        // x-major, then y, then z
+
+        size_t index(int i, int j, int k) const
+        { return (size_t(i) * ny + j) * nz + k; }
+    };
+
+    // throws for a level below 0 or past the single-cell level of the grid
+    FieldPyramid(const ExportSettings& settings, int nx, int ny, int nz);
+
+    // the z planes of level 0 the slice view needs - the 2^n planes under
+    // the slice of the deepest selected level n
+    void slab(int& firstPlane, int& planes) const;
+
+    // builds the levels from level 0 as the view needs it - the planes
+    // from firstPlane on for the slice view, the mean along z (nz = 1)
+    // for the projection, every plane for the volume - and writes the
+    // selected ones for this step
+    void write(unsigned long int step, level fields, int firstPlane = 0);
+
+    // builds level n + 1 from level n
+    static level downsample(const level& finer);
+
+private:
+    ExportSettings settings;
+    int nx, ny, nz;
+    int deepest;                        // deepest level written
+    vector<level> levels;
+    vector<std::ofstream> files;        // one per selected level
+
+    // the plane of level 0 the slice view shows
+    int slicePlane() const;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef GOLDENTRACE_H
+#define GOLDENTRACE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+using std::vector, std::string;
+
+
+// State of a cluster after one step, used to check that two builds run
+// the same physics
+struct StepState
+{
+    unsigned long int
+        step = 0,
+        aliveBacteria = 0,
+        totalBacteria = 0;
+
+    long double
+        nutrientSum = 0.0f,             // sum over the nutrient field
+        acetateSum = 0.0f,              // sum over the acetate field
+        energySum = 0.0f;               // sum of energy of alive bacteria
+    double CO2Level = 0.0f;
+
+    uint64_t fieldHash = 0;             // hash of both fields, bit for bit
+};
+
+
+class GoldenTrace
+{
+
+public:
+    // settings the trace was recorded with, so a check can replay them
+    unsigned int seed = 0;
+    int numBacteria = 100;
+
+    vector<StepState> steps;
+
+    void write(const string& filename) const;
+    static GoldenTrace read(const string& filename);
+
+    // returns the index of the first step where the two traces differ,
+    // or -1 if they agree. With tolerance 0 everything including the field
+    // hash must match exactly, otherwise values are compared relative to
+    // tolerance and the hash is ignored. what names the first mismatch.
+    long int firstDivergence(const GoldenTrace& other, double tolerance,
+                             string& what) const;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef LIVEFEED_H
+#define LIVEFEED_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+using std::vector, std::string;
+
+
+// Publishes vis frames into a POSIX shared-memory ring buffer so a viewer
+// can follow a run while it is going (see visualiser.py --live).
+//
+// Layout of the segment /dev/shm/<name>, little endian, no padding other
+// than what is listed:
+//
+//   header, 64 bytes
+//     0   char[8]  magic "BIOSIMLF"
+//     8   uint32   version (1)
+//     12  uint32   slotCount
+//     16  uint32   nx, ny          size of the field slice
+//     24  uint32   maxBacteria     capacity of the position list of a slot
+//     28  uint32   (unused)
+//     32  uint64   slotBytes       size of one slot
+//     40  uint64   sequence        frames published so far, the newest
+//                                  frame is in slot (sequence - 1) % slotCount
+//     48  16 bytes reserved
+//
+//   slotCount slots of slotBytes each, starting at byte 64
+//     0   uint64   stamp           2 * frame + 1 while the slot is being
+//                                  written, 2 * frame + 2 once complete
+//     8   uint64   timeStep
+//     16  double   timeElapsed
+//     24  uint32   aliveBacteria   total alive in the cluster
+//     28  uint32   positionCount   number of positions stored (capped)
+//     32  float[nx * ny]           nutrient slice, x-major
+//     ..  float[nx * ny]           acetate slice, x-major
+//     ..  int32[2 * maxBacteria]   x,y pairs of alive bacteria
+//
+// A reader copies a slot and checks that stamp is even and unchanged
+// afterwards; otherwise the writer lapped it and the frame is skipped.
+// The writer never waits for readers, frames are dropped instead.
+class LiveFeed
+{
+
+private:
+    string name;
+    int descriptor = -1;
+    unsigned char* base = nullptr;
+    size_t bytes = 0;
+
+    uint32_t slotCount, nx, ny, maxBacteria;
+    uint64_t slotBytes;
+    uint64_t published = 0;
+
+    unsigned char* slot(uint64_t frame) const;
+
+public:
+    static const size_t headerBytes = 64;
+    static const size_t slotHeaderBytes = 32;
+
+    // creates (or replaces) the segment /<name>
+    LiveFeed(const string& name, int nx, int ny,
+             uint32_t maxBacteria = 65536, uint32_t slotCount = 8);
+    ~LiveFeed();
+
+    LiveFeed(const LiveFeed&) = delete;
+    LiveFeed& operator=(const LiveFeed&) = delete;
+
+    void publish(unsigned long int timeStep, double timeElapsed,
+                 unsigned long int aliveBacteria,
+                 const vector<double>& nutrientSlice,
+                 const vector<double>& acetateSlice,
+                 const vector<int>& positions);
+};
+
+#endif
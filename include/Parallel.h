@@ -0,0 +1,77 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+// Runs body(begin, end) over [0, count) split into one contiguous chunk per
+// hardware thread, and waits for all of them. Chunk t always covers the
+// same range for the same count, so data initialised here is first
+// touched - and placed in memory - by the thread that owns that chunk.
+// The first exception thrown by a chunk is rethrown on the caller.
+template <typename Body>
+void parallelFor(std::size_t count, Body body)
+{
+    std::size_t threads = std::thread::hardware_concurrency();
+    if (threads > count)
+        threads = count;
+    if (threads <= 1){
+        if (count > 0)
+            body(std::size_t(0), count);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    std::vector<std::exception_ptr> errors(threads);
+    workers.reserve(threads - 1);
+
+    auto chunk = [&](std::size_t t){
+        try{
+            body(count * t / threads, count * (t + 1) / threads);
+        }
+        catch (...){
+            errors[t] = std::current_exception();
+        }
+    };
+
+    for (std::size_t t = 1; t < threads; t++)
+        workers.emplace_back(chunk, t);
+    chunk(0);
+    for (std::thread& worker : workers)
+        worker.join();
+
+    for (std::exception_ptr& error : errors)
+        if (error)
+            std::rethrow_exception(error);
+}
+
+
+// Allocator that leaves trivially constructible elements uninitialised
+// when a container is sized, so their pages are only touched when
+// parallelFor fills them
+template <typename T>
+struct firstTouchAllocator : std::allocator<T>
+{
+    template <typename U>
+    struct rebind { typedef firstTouchAllocator<U> other; };
+
+    firstTouchAllocator() = default;
+    template <typename U>
+    firstTouchAllocator(const firstTouchAllocator<U>&) noexcept {}
+
+    template <typename U>
+    void construct(U* address)
+    { ::new (static_cast<void*>(address)) U; }
+
+    template <typename U, typename... Args>
+    void construct(U* address, Args&&... args)
+    { ::new (static_cast<void*>(address)) U(std::forward<Args>(args)...); }
+};
+
+#endif
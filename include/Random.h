@@ -1,44 +1,100 @@
-#include <vector>
-#include <random>
-
-#ifndef RANDOM_H
-#define RANDOM_H
-
-
-using namespace std;
-
-
-class RandomGenerator {
-public:
-    // Constructor initializes the random number generator
-    RandomGenerator();
-    // Method to generate a random double in the range [min, max]
-    double Double(double , double );
-    // Overloaded method to generate a random number from 0 to max 
-    double Double(double max);
-
-	// Method to generate a random integer in the range [min, max]
-    int Int(int , int ); 
-    // Overloaded method to generate a random number from 0 to max
-    int Int(int max);
- 
-    // These functions use mercenne twister
-    // Method to generate a random double in the range [min, max]
-    double DoubleMT(double , double );
-    // Overloaded method to generate a random number from 0 to max
-    double DoubleMT(double max);
-    
-    // Method to generate a random integer in the range [min, max]
-    int IntMT(int , int ); 
-    // Overloaded method to generate a random number from 0 to max
-    int IntMT(int max);
-	    
-	vector<vector<vector<double>>> generate3DVector
-	    (vector<int> dim, int, int );
-
-
-private:
-    mt19937 mt; // Mersenne Twister engine
-};
-
-#endif
+#include <vector>
+#include <random>
+#include <cstdint>
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+
+using namespace std;
+
+
+class RandomGenerator {
+public:
+    // Constructor initializes the random number generator
+    RandomGenerator();
+    // Independent stream for parallel work - the Mersenne Twister is seeded
+    // from the run seed, the stream and the substream, rand() is left
+    // alone. The *MT methods draw from it
+    RandomGenerator(unsigned int seed, unsigned int stream,
+                    unsigned int substream = 0);
+
+    // Deterministic mode - every generator created after this call (and
+    // the shared rand() stream) is seeded with seed instead of the time
+    static void setSeed(unsigned int seed);
+    static bool isDeterministic();
+    static unsigned int getSeed();
+    // the fixed seed, or the time when there is none
+    static unsigned int runSeed();
+    // Method to generate a random double in the range [min, max]
+    double Double(double , double );
+    // Overloaded method to generate a random number from 0 to max 
+    double Double(double max);
+
+	// Method to generate a random integer in the range [min, max]
+    int Int(int , int ); 
+    // Overloaded method to generate a random number from 0 to max
+    int Int(int max);
+ 
+    // These functions use mercenne twister
+    // Method to generate a random double in the range [min, max]
+    double DoubleMT(double , double );
+    // Overloaded method to generate a random number from 0 to max
+    double DoubleMT(double max);
+    
+    // Method to generate a random integer in the range [min, max]
+    int IntMT(int , int ); 
+    // Overloaded method to generate a random number from 0 to max
+    int IntMT(int max);
+	    
+	vector<vector<vector<double>>> generate3DVector
+	    (vector<int> dim, int, int );
+
+
+private:
+    mt19937 mt; // Mersenne Twister engine
+
+    static bool fixedSeed;
+    static unsigned int seedValue;
+};
+
+
+// Counter-based stream (SplitMix64) for work that needs a fresh stream
+// every step, like each bacterium of a step. The key is hashed into a
+// 64 bit state once and every draw is one add and one mix, so building one
+// costs next to nothing, unlike seeding a Mersenne Twister. The same key
+// always gives the same numbers
+class KeyedGenerator {
+public:
+    KeyedGenerator(unsigned int seed, unsigned int stream,
+                   uint64_t substream, uint64_t step);
+
+    // random integer in the range [min, max]
+    int Int(int min, int max)
+    {
+        const uint64_t span = uint64_t(int64_t(max) - min + 1);
+        return int(min + int64_t(((next() >> 32) * span) >> 32));
+    }
+    // random double in the range [0, max)
+    double Double(double max)
+    {
+        return (next() >> 11) * 0x1.0p-53 * max;
+    }
+
+private:
+    uint64_t state;
+
+    static uint64_t mix(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    uint64_t next()
+    {
+        state += 0x9E3779B97F4A7C15ULL;
+        return mix(state);
+    }
+};
+
+#endif
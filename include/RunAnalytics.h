@@ -0,0 +1,78 @@
+#ifndef RUNANALYTICS_H
+#define RUNANALYTICS_H
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+using std::vector, std::string;
+
+
+// Statistics of a run kept while it goes, so a run needs no second pass
+// over its CSV. Every observation updates
+//   - the peak alive population and the time it was reached
+//   - the highest specific growth rate d ln(alive) / dt, measured over a
+//     sliding window, and the doubling time it gives
+//   - the nutrient half-life, the first time the total nutrient is down to
+//     half of the first observation (interpolated between observations)
+// and a downsampled copy of the series. The series holds at most capacity
+// samples: when it is full every other sample is dropped and from then on
+// only every second observation is kept, so it always spans the whole run
+// at an even spacing.
+class RunAnalytics
+{
+
+public:
+    struct sample
+    {
+        double timeElapsed;
+        unsigned long int aliveBacteria, totalBacteria;
+        double CO2Level, nutrientLevel, acetateLevel;
+    };
+
+    explicit RunAnalytics(std::size_t capacity = 1024,
+                          double growthWindow = 10.0f);
+
+    void observe(const sample& current);
+
+    unsigned long int getPeakPopulation() const;
+    double getTimeToPeak() const;
+    // per unit time, 0 until the window has been filled once
+    double getGrowthRate() const;
+    // ln 2 / growth rate, -1 when the population never grew
+    double getDoublingTime() const;
+    // -1 while the nutrient has not halved
+    double getNutrientHalfLife() const;
+    const vector<sample>& getSeries() const;
+
+    // share of the run each worker thread spent in tasks, written to the
+    // summary when set (see TaskPool::utilisation)
+    void setThreadUtilisation(const vector<double>& shares);
+
+    // summary file - the statistics as "# name,value" lines followed by
+    // the downsampled series with the columns of the run CSV, so
+    // pandas.read_csv(file, comment="#") reads the series directly
+    void write(const string& filename) const;
+
+private:
+    std::size_t capacity;
+    double growthWindow;
+
+    unsigned long int observations = 0;
+    sample first{}, last{};
+
+    unsigned long int peakPopulation = 0;
+    double timeToPeak = 0.0f;
+
+    std::deque<std::pair<double, double>> window;   // time, ln alive
+    double growthRate = 0.0f;
+
+    double nutrientHalfLife = -1.0f;
+
+    vector<sample> series;
+    unsigned long int stride = 1;
+
+    vector<double> threadUtilisation;
+};
+
+#endif
@@ -1,91 +1,209 @@
-#ifndef SPECIES_H
-#define SPECIES_H
-
-#include <vector>
-#include "Environment.h"
-using std::vector, std::min, std::max;
-
-
-class Bacterium
-{
-        // Class to define the characteristics of the bacteria species
-        // The growth of the bacteria depends on the Environment it is in
-
-private:
-    // unique value to identify a bacteria
-    // as long as the bacteria value is 0, the bacteria is not registered
-    // when the bacteria is registered, the value changes from 0 to another
-    // value and cannot be changed again
-    unsigned long int bacteriaID = 0;
-
-protected:
-
-    static double temporalResolution;           // unit - seconds
-    
-
-    // Value indicating wether bacteria is alive or dead
-    bool alive = 1;
-    
-    // The biological specifications of the bacteria
-    double 
-     // Minimum energy a Bacterium can have ::
-        minEnergy = 0,
-    // Maximum energy a Bacterium can have ::
-        maxEnergy = 500.0f,
-    // The constant energy consumed by bacteria to live ::
-        livingEnergy = 1.0f,         // CHANGED: Lowered from 5.0 so they don't starve instantly
-    // Energy required by Bacterium for reproduction ::
-        reproductionEnergy = 300.0f,
-    // Maximum amount of acetate concentration a bacterium can handle ::
-        acidicLimit = 150.0f,        // CHANGED: Increased from 20.0 to 150.0 so they survive waste buildup longer
-    // What the bacterium defines as proximity ::
-        proximity = 3.0f,
-    // Energy Bacterium gets per unit of nutrient ::
-        energyPerNutrient = 10.0f,  
-    // CO2 released per unit energy consumption
-        CO2PerEnergy = 10.0f,
-    // max rate of consumption of energy ::
-        rateOfConsumption = 1.0f,
-    // speed in micrometers per second ::
-        movementSpeed = 1.0f;
-
-    vector<int> position = {0,0,0};
-    double energy = 0.0f;               // The energy of the Bacterium
-    
-    double getAcetateNearby(Environment* surroundings) const;
-    
-
-public:
-    Bacterium();
-    Bacterium(const vector<int> , double const energy_lvl = 300.0f);
-							// energy of bacteria is between 0 and energy level
-    
-    // function to update the value of the bacteriaID if applicable
-    void setID(unsigned long int);
-    unsigned long int getID();
-
-    
-    // activities (mutator functions) 
-    void move( Environment* );
-    void eat( Environment* );
-    void reproduce( Environment* , Bacterium& );
-    void live( Environment* , Bacterium& );
-    void die();
-    void adapt( Environment* );
-    static void updateTemporalResolution(const double tempresNew);
-
-    // ACCESSORS
-    double getEnergy();
-    // function to check wether the bacteria satisfies the conditions to live
-    bool canLive( Environment* ) const;
-    // checks wether the bacteria is alive
-    bool isAlive() const;
-    static double getTemporalResolution();
-
-    // Defining an equality operator for `remove` to work correctly
-    bool operator==(const Bacterium&) const;
-    vector<int> getPosition() const { return position; }
-};
-
-
-#endif
+#ifndef SPECIES_H
+#define SPECIES_H
+
+#include <cstddef>
+#include <vector>
+#include "Environment.h"
+using std::vector, std::min, std::max;
+
+
+// The biological specifications of a strain. Every strain is a struct with
+// the same static constexpr members, so the agent kernel
+// (Bacterium::liveBlock<Strain>) is compiled with them as constants.
+// New strains also need an instantiation line at the end of Species.cpp.
+struct StandardStrain
+{
+    static constexpr const char* name = "standard";
+
+    static constexpr double
+     // Minimum energy a Bacterium can have ::
+        minEnergy = 0,
+    // Maximum energy a Bacterium can have ::
+        maxEnergy = 500.0f,
+    // The constant energy consumed by bacteria to live ::
+        livingEnergy = 1.0f,         // CHANGED: Lowered from 5.0 so they don't starve instantly
+    // Energy required by Bacterium for reproduction ::
+        reproductionEnergy = 300.0f,
+    // Maximum amount of acetate concentration a bacterium can handle ::
+        acidicLimit = 150.0f,        // CHANGED: Increased from 20.0 to 150.0 so they survive waste buildup longer
+    // What the bacterium defines as proximity ::
+        proximity = 3.0f,
+    // Energy Bacterium gets per unit of nutrient ::
+        energyPerNutrient = 10.0f,  
+    // CO2 released per unit energy consumption
+        CO2PerEnergy = 10.0f,
+    // max rate of consumption of energy ::
+        rateOfConsumption = 1.0f,
+    // speed in micrometers per second ::
+        movementSpeed = 1.0f;
+
+    // Movement is a random walk, or with chemotactic set biased up the
+    // nutrient gradient and down the acetate gradient: on each axis the
+    // step goes the way of the drift
+    //   nutrientTaxis * d(nutrient) - acetateTaxis * d(acetate)
+    // with a probability of |drift| (capped at 1)
+    static constexpr bool chemotactic = false;
+    static constexpr double
+        nutrientTaxis = 0.0f,
+        acetateTaxis = 0.0f;
+};
+
+// A strain that copes with twice the acetate, paid for with a higher
+// cost of living and a later reproduction
+struct AcidTolerantStrain : StandardStrain
+{
+    static constexpr const char* name = "acidTolerant";
+
+    static constexpr double
+        livingEnergy = 1.5f,
+        reproductionEnergy = 350.0f,
+        acidicLimit = 300.0f;
+};
+
+// A strain that swims towards food and away from its own waste
+struct ChemotacticStrain : StandardStrain
+{
+    static constexpr const char* name = "chemotactic";
+
+    static constexpr bool chemotactic = true;
+    static constexpr double
+        nutrientTaxis = 20.0f,
+        acetateTaxis = 0.2f;
+};
+
+class RandomGenerator;
+
+
+class Bacterium
+{
+        // Class to define the characteristics of the bacteria species
+        // The growth of the bacteria depends on the Environment it is in
+
+public:
+    // changes a block of bacteria made to the environment totals
+    struct tally
+    {
+        double CO2Released = 0.0;
+        long double nutrientConsumed = 0.0, acetateReleased = 0.0;
+    };
+
+private:
+    // unique value to identify a bacteria
+    // as long as the bacteria value is 0, the bacteria is not registered
+    // when the bacteria is registered, the value changes from 0 to another
+    // value and cannot be changed again
+    unsigned long int bacteriaID = 0;
+
+protected:
+
+    static double temporalResolution;           // unit - seconds
+    
+
+    // Value indicating wether bacteria is alive or dead
+    bool alive = 1;
+    unsigned char cause = 0;            // a deathCause, set by die()
+    
+    // The biological specifications used by the per-object functions
+    // (move, eat, live, ...). They are the standard strain's; populations
+    // of other strains are updated through liveBlock<Strain>
+    static constexpr double
+        minEnergy = StandardStrain::minEnergy,
+        maxEnergy = StandardStrain::maxEnergy,
+        livingEnergy = StandardStrain::livingEnergy,
+        reproductionEnergy = StandardStrain::reproductionEnergy,
+        acidicLimit = StandardStrain::acidicLimit,
+        proximity = StandardStrain::proximity,
+        energyPerNutrient = StandardStrain::energyPerNutrient,
+        CO2PerEnergy = StandardStrain::CO2PerEnergy,
+        rateOfConsumption = StandardStrain::rateOfConsumption,
+        movementSpeed = StandardStrain::movementSpeed;
+
+    vector<int> position = {0,0,0};
+    double energy = 0.0f;               // The energy of the Bacterium
+    
+    double getAcetateNearby(Environment* surroundings) const;
+    
+
+public:
+    // why a bacterium died
+    enum deathCause : unsigned char
+    {
+        living = 0,
+        starvation = 1,         // energy dropped to minEnergy
+        acidity = 2,            // acetate nearby went over acidicLimit
+        unknown = 3
+    };
+
+    // plain copy of the state of an alive bacterium, used to send bacteria
+    // between processes
+    struct record
+    {
+        unsigned long int id;
+        int position[3];
+        double energy;
+    };
+
+    Bacterium();
+    Bacterium(const vector<int> , double const energy_lvl = 300.0f);
+							// energy of bacteria is between 0 and energy level
+    // same, drawing the energy from the given stream instead of rand(), for
+    // populations seeded in parallel
+    Bacterium(vector<int> , double energy_lvl, RandomGenerator& );
+    // restores a bacterium saved with save(), keeping its ID
+    explicit Bacterium(const record&);
+    record save() const;
+    
+    // function to update the value of the bacteriaID if applicable
+    void setID(unsigned long int);
+    unsigned long int getID() const;
+
+    
+    // activities (mutator functions) 
+    void move( Environment* );
+    void eat( Environment* );
+    void reproduce( Environment* , Bacterium& );
+    void live( Environment* , Bacterium& );
+    // batched form of live() - applies the same rules to count bacteria
+    // starting at block in one pass, appending newborns to births.
+    // Bacteria that die are left in place with isAlive() false.
+    // Every bacterium draws from a KeyedGenerator of the seed, its ID and
+    // step, and the changes to the environment totals are summed into
+    // totals instead of being applied, so blocks that do not share patches
+    // can run at once, on any thread or process, with the same result.
+    // The constants come from Strain and are folded in at compile time
+    template <class Strain = StandardStrain>
+    static void liveBlock( Environment* , Bacterium* block, std::size_t count,
+                           vector<Bacterium>& births, unsigned int seed,
+                           unsigned long int step, tally& totals );
+    // signature shared by all liveBlock<Strain>
+    typedef void (*kernel)( Environment* , Bacterium* , std::size_t ,
+                            vector<Bacterium>& , unsigned int ,
+                            unsigned long int , tally& );
+    void die( deathCause reason = unknown );
+    void adapt( Environment* );
+    static void updateTemporalResolution(const double tempresNew);
+
+    // ACCESSORS
+    double getEnergy();
+    // function to check wether the bacteria satisfies the conditions to live
+    bool canLive( Environment* ) const;
+    // checks wether the bacteria is alive
+    bool isAlive() const;
+    deathCause getDeathCause() const;
+    // how far from its position a bacterium moves, eats or senses acetate
+    // in one step
+    int getReach() const;
+    template <class Strain>
+    static constexpr int reach()
+    { return (int)Strain::movementSpeed + max(1, (int)Strain::proximity); }
+    static double getTemporalResolution();
+
+    // Defining an equality operator for `remove` to work correctly
+    bool operator==(const Bacterium&) const;
+    vector<int> getPosition() const { return position; }
+    // one coordinate of the position, without the copy
+    int getCoordinate(int axis) const { return position[axis]; }
+};
+
+
+#endif
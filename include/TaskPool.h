@@ -0,0 +1,73 @@
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Work-stealing thread pool. run() hands out a batch of tasks, each thread
+// starts on a contiguous share of them and, once its own deque is empty,
+// steals from the front of the others - so a few heavy tasks (dense
+// tiles of a colony) do not leave the rest of the threads idle. The
+// calling thread works as thread 0.
+class TaskPool
+{
+
+public:
+    explicit TaskPool(unsigned int threads);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    unsigned int size() const;
+
+    // runs task(i) for every i in [0, count) and returns when all are done.
+    // The first exception thrown by a task is rethrown here
+    void run(std::size_t count, const std::function<void(std::size_t)>& task);
+
+    // share of the time since construction or the last reset each thread
+    // spent running tasks
+    std::vector<double> utilisation() const;
+    void resetUtilisation();
+
+private:
+    struct worker
+    {
+        std::mutex lock;
+        std::deque<std::size_t> tasks;
+        std::atomic<int64_t> busy{0};       // nanoseconds spent in tasks
+    };
+
+    std::vector<std::unique_ptr<worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex lock;
+    std::condition_variable wake, done;
+    uint64_t generation = 0;
+    bool stopping = false;
+
+    std::atomic<const std::function<void(std::size_t)>*> current{nullptr};
+    std::atomic<std::size_t> pending{0};
+    std::exception_ptr error;
+
+    std::chrono::steady_clock::time_point since;
+
+    void work(unsigned int self);
+    // runs tasks until none are left anywhere
+    void drain(unsigned int self);
+    // own tasks from the back, then the oldest tasks of the others
+    bool next(unsigned int self, std::size_t& index);
+};
+
+#endif
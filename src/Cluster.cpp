@@ -1,165 +1,647 @@
-#include <iostream>
-#include <fstream>
-#include <stdexcept>
-#include <iomanip>
-#include <string>
-using namespace std;
-
-#include "Cluster.h"
-#include "Random.h"
-
-Cluster::Cluster(int numBacteria, int randomiseType, double energyValue){
-    RandomGenerator ranGen;
-
-    switch (randomiseType)
-    {
-        case 1:
-            for (int i = 0; i < numBacteria; ++i){
-                vector<int> randomPosition = { ranGen.Int(0, ranges[0]), 
-                                               ranGen.Int(0, ranges[1]), 
-                                               ranGen.Int(0, ranges[2]) };
-                double randomEnergy = ranGen.Double(0, energyValue);
-                
-                Bacterium* individual = new Bacterium(randomPosition, randomEnergy);
-                add(individual);
-            }
-        default:
-            break;
-    }
-}
-
-pair<bool, unsigned long int> Cluster::isPresent(Bacterium individual){
-    for (unsigned long int i = 0; i < alive.size(); i++)
-        if (alive[i] == individual)
-            return {true, i};
-    return {false, 0};
-}
-
-void Cluster::add(Bacterium* individual){
-    totalBacteria++;
-    totalAliveBacteria++;
-
-    if ( individual->getID() == 0 )
-        individual->setID( totalBacteria );
-    else 
-        cout << "Warning : stray bacteria added to cluster" << endl;
-    alive.push_back( *individual );
-}
-
-void Cluster::omit(Bacterium* individual){
-    pair<bool, unsigned long int> isPresentValue = isPresent(*individual);
-
-    if (!isPresentValue.first)
-        throw runtime_error("Value not found in the vector");
-    else{
-        dead.push_back(alive[isPresentValue.second]);
-        totalDeadBacteria++;
-        alive.erase(alive.begin() + isPresentValue.second);
-        totalAliveBacteria--;
-    }
-}
-
-void Cluster::step(){
-    Bacterium* offspring = new Bacterium();
-    vector<Bacterium> newMembers;
-    vector<Bacterium> deadMembers;
-    bool aliveBefore;
-
-    for (Bacterium& individual : alive){
-        aliveBefore = individual.isAlive();
-        individual.live(static_cast<Environment*>(this), *offspring);
-
-        if (offspring->isAlive() == 1){
-            newMembers.push_back(*offspring);
-            offspring = new Bacterium();
-        }
-
-        if (aliveBefore && !individual.isAlive()){
-            deadMembers.push_back(individual);
-        }
-    }
-
-    diffuse(); 
-
-    for (Bacterium& individual : newMembers)
-        add(&individual);
-    for (Bacterium& individual : deadMembers)
-        omit(&individual);
-
-    delete offspring; 
-}
-
-void Cluster::updateTemporalResolution(double newResolution){
-    Environment::updateTemporalResolution(newResolution);
-    Bacterium::updateTemporalResolution(newResolution);
-}
-
-void Cluster::run(string filename){
-    string mainFile = "../results/" + filename;
-    ofstream file(mainFile);
-
-    string visFile = "../results/vis_data.csv";
-    ofstream vfile(visFile);
-
-    if (!file.is_open() || !vfile.is_open()){
-        throw runtime_error("Could not open files for writing.");
-    }
-
-    file << "TimeElapsed,AliveBacteria,TotalBacteria,NetCO2,TotalNutrient,TotalAcetate\n";
-
-    unsigned long int timeStep = 0;
-    double timeElapsed = 0.0f;
-    double tempres = Bacterium::getTemporalResolution();
-    
-    const int visFrequency = 5; 
-    const double maxTime = 2000.0;
-
-    cout << "\033[2J"; 
-
-    while (totalAliveBacteria > 0 && timeElapsed < maxTime){
-        step(); 
-        timeStep++;
-        timeElapsed = timeStep * tempres;
-
-        double currentCO2 = getCO2Level();
-        double currentNutrient = getNutrientLevel();
-        double currentAcetate = getAcetateLevel();
-        file << timeElapsed << "," << totalAliveBacteria << "," << totalBacteria << "," 
-             << currentCO2 << "," << currentNutrient << "," << currentAcetate << "\n";
-
-        if (timeStep % visFrequency == 0) {
-            int zSlice = 25;
-            for(int x=0; x<ranges[0]; x++) {
-                for(int y=0; y<ranges[1]; y++) {
-                    double nut = locale[x][y][zSlice].nutrientLevel;
-                    double ace = locale[x][y][zSlice].acetateLevel;
-                    
-                    if(nut > 1.0) vfile << timeStep << ",0," << x << "," << y << "," << nut << "\n";
-                    if(ace > 1.0) vfile << timeStep << ",1," << x << "," << y << "," << ace << "\n";
-                }
-            }
-            for (Bacterium& b : alive) {
-                vector<int> pos = b.getPosition(); 
-                vfile << timeStep << ",2," << pos[0] << "," << pos[1] << ",1\n";
-            }
-            for (Bacterium& b : dead) {
-                vector<int> pos = b.getPosition();
-                vfile << timeStep << ",3," << pos[0] << "," << pos[1] << ",1\n";
-            }
-        }
-        
-        cout << "\033[H";
-        cout << "Simulation Data:\n================\n";
-        cout << fixed << setprecision(2);
-        cout << "Time Elapsed   : " << timeElapsed << " / " << maxTime << "\n";
-        cout << "Alive Bacteria : " << totalAliveBacteria << "\n";
-        cout << "Total Bacteria : " << alive.size()+dead.size() << "\n";
-        cout << "Net CO2 Level  : " << currentCO2 << "\n";
-        cout << "Total Nutrient : " << currentNutrient << "\n";
-        cout << "Total Acetate  : " << currentAcetate << "\n";
-        cout << flush;
-    }
-
-    file.close();
-    vfile.close();
-}
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+using namespace std;
+
+#include "Cluster.h"
+#include "BoundedQueue.h"
+#include "Random.h"
+#include "Parallel.h"
+
+Cluster::Cluster(int numBacteria, int randomiseType, double energyValue,
+                 vector<int> gridSize, double nutrientValue)
+    : Environment(0, gridSize, nutrientValue){
+    populations.push_back({StandardStrain::name,
+                           &Bacterium::liveBlock<StandardStrain>,
+                           Bacterium::reach<StandardStrain>(), {}});
+
+    switch (randomiseType)
+    {
+        case 1:
+            scatter(0, numBacteria, energyValue);
+        default:
+            break;
+    }
+}
+
+vector<Bacterium> Cluster::seedPopulation(int numBacteria, double energyValue,
+                                          const vector<int>& extent,
+                                          unsigned long int firstID,
+                                          unsigned int stream){
+    const size_t count = max(numBacteria, 0), blockSize = 4096;
+    const unsigned int seed = RandomGenerator::runSeed();
+    vector<vector<Bacterium>> blocks((count + blockSize - 1) / blockSize);
+
+    parallelFor(blocks.size(), [&](size_t first, size_t last){
+        for (size_t b = first; b < last; b++){
+            RandomGenerator generator(seed, stream, b);
+            const size_t begin = b * blockSize;
+            const size_t end = min(count, begin + blockSize);
+
+            blocks[b].reserve(end - begin);
+            for (size_t i = begin; i < end; i++){
+                vector<int> randomPosition = { generator.IntMT(0, extent[0] - 1),
+                                               generator.IntMT(0, extent[1] - 1),
+                                               generator.IntMT(0, extent[2] - 1) };
+                double randomEnergy = generator.DoubleMT(0, energyValue);
+
+                blocks[b].emplace_back(std::move(randomPosition), randomEnergy,
+                                       generator);
+                blocks[b].back().setID(firstID + i);
+            }
+        }
+    });
+
+    vector<Bacterium> seeded;
+    seeded.reserve(count);
+    for (vector<Bacterium>& block : blocks)
+        for (Bacterium& individual : block)
+            seeded.push_back(std::move(individual));
+    return seeded;
+}
+
+void Cluster::scatter(size_t strain, int numBacteria, double energyValue){
+    // stream 0 is the environment, every population has its own
+    vector<Bacterium> seeded = seedPopulation(numBacteria, energyValue, extent,
+                                              totalBacteria + 1, strain + 1);
+
+    vector<Bacterium>& members = populations[strain].members;
+    members.reserve(members.size() + seeded.size());
+    for (Bacterium& individual : seeded)
+        members.push_back(std::move(individual));
+
+    totalBacteria += seeded.size();
+    totalAliveBacteria += seeded.size();
+}
+
+void Cluster::addPopulation(const string& strain, Bacterium::kernel live,
+                            int reach, int numBacteria, double energyValue){
+    for (const population& existing : populations)
+        if (existing.strain == strain)
+            throw invalid_argument("Error: strain " + strain + " is already in the cluster.");
+
+    populations.push_back({strain, live, reach, {}});
+    scatter(populations.size() - 1, numBacteria, energyValue);
+}
+
+void Cluster::add(Bacterium* individual, size_t strain){
+    totalBacteria++;
+    totalAliveBacteria++;
+
+    if ( individual->getID() == 0 )
+        individual->setID( totalBacteria );
+    else 
+        cout << "Warning : stray bacteria added to cluster" << endl;
+    populations[strain].members.push_back( std::move(*individual) );
+}
+
+void Cluster::bury(Bacterium& individual){
+    vector<int> position = individual.getPosition();
+    recordDeath(position, max(0.0, individual.getEnergy()));
+
+    if (deathLog)
+        deathLog->append(individual.getID(), stepsTaken, position,
+                         individual.getDeathCause());
+
+    totalDeadBacteria++;
+    totalAliveBacteria--;
+}
+
+void Cluster::step(){
+    vector<vector<Bacterium>> newMembers(populations.size());
+    stepsTaken++;
+
+    // the strains take turns, each through its own kernel
+    for (size_t strain = 0; strain < populations.size(); strain++){
+        tiling tiles = binTiles(strain);
+        for (int colour = 0; colour < 4; colour++)
+            liveColour(strain, tiles, colour);
+        applyTiles(tiles, newMembers[strain]);
+    }
+
+    diffuse(); 
+    removeDead();
+
+    for (size_t strain = 0; strain < populations.size(); strain++)
+        for (Bacterium& individual : newMembers[strain])
+            add(&individual, strain);
+}
+
+Cluster::tiling Cluster::binTiles(size_t strain){
+    // a tile's bacteria touch patches up to reach outside it, two tiles of
+    // one colour are a whole tile apart, so twice the reach keeps them apart
+    int reach = 1;
+    for (const population& current : populations)
+        reach = max(reach, current.reach);
+
+    tiling tiles;
+    tiles.size = 2 * reach;
+    tiles.tilesX = (extent[0] + tiles.size - 1) / tiles.size;
+    tiles.tilesY = (extent[1] + tiles.size - 1) / tiles.size;
+    const size_t count = size_t(tiles.tilesX) * tiles.tilesY;
+    tiles.births.resize(count);
+    tiles.totals.resize(count);
+
+    // counting sort by tile, then by ID within a tile. The members are cut
+    // into chunks, each with its own count per tile, so the counting and
+    // the scatter run on the pool and keep the order within a chunk
+    vector<Bacterium>& members = populations[strain].members;
+    const size_t workers = pool ? 4 * pool->size() : 1;
+    const size_t chunks = max<size_t>(1, min(workers,
+                                              (members.size() + 16383) / 16384));
+    const size_t chunkSize = max<size_t>(1, (members.size() + chunks - 1) / chunks);
+    vector<unsigned int> tileOf(members.size());
+    vector<vector<size_t>> fill(chunks, vector<size_t>(count, 0));
+
+    runTasks(chunks, [&](size_t c){
+        const size_t end = min(members.size(), (c + 1) * chunkSize);
+        for (size_t n = c * chunkSize; n < end; n++){
+            int x = min(max(members[n].getCoordinate(0), 0), extent[0] - 1);
+            int y = min(max(members[n].getCoordinate(1), 0), extent[1] - 1);
+            tileOf[n] = (x / tiles.size) * tiles.tilesY + y / tiles.size;
+            fill[c][tileOf[n]]++;
+        }
+    });
+
+    // tile t starts at first[t], chunk c's share of it after those of the
+    // chunks before it
+    vector<size_t>& first = tiles.first;
+    first.assign(count + 1, 0);
+    for (size_t t = 0; t < count; t++){
+        size_t at = first[t];
+        for (size_t c = 0; c < chunks; c++){
+            const size_t share = fill[c][t];
+            fill[c][t] = at;
+            at += share;
+        }
+        first[t + 1] = at;
+    }
+
+    // (ID, index) pairs, so the sort within a tile reads them in place
+    vector<pair<unsigned long int, size_t>> order(members.size());
+    runTasks(chunks, [&](size_t c){
+        const size_t end = min(members.size(), (c + 1) * chunkSize);
+        for (size_t n = c * chunkSize; n < end; n++)
+            order[fill[c][tileOf[n]]++] = {members[n].getID(), n};
+    });
+    // most bacteria stay in their tile, so most tiles are still in order
+    runTasks(count, [&](size_t t){
+        auto begin = order.begin() + first[t], end = order.begin() + first[t + 1];
+        if (!is_sorted(begin, end))
+            sort(begin, end);
+    });
+
+    bool moved = false;
+    for (size_t n = 0; n < order.size() && !moved; n++)
+        moved = order[n].second != n;
+    if (!moved)
+        return tiles;
+
+    vector<Bacterium> sorted;
+    sorted.reserve(members.size());
+    for (const auto& entry : order)
+        sorted.push_back(std::move(members[entry.second]));
+    members.swap(sorted);
+    return tiles;
+}
+
+void Cluster::runTasks(size_t count, const function<void(size_t)>& task){
+    if (pool)
+        pool->run(count, task);
+    else
+        for (size_t i = 0; i < count; i++)
+            task(i);
+}
+
+void Cluster::liveColour(size_t strain, tiling& tiles, int colour){
+    population& current = populations[strain];
+    const vector<size_t>& first = tiles.first;
+    const unsigned int seed = RandomGenerator::runSeed();
+
+    vector<size_t> batch;
+    for (int tx = colour % 2; tx < tiles.tilesX; tx += 2)
+        for (int ty = colour / 2; ty < tiles.tilesY; ty += 2){
+            size_t t = size_t(tx) * tiles.tilesY + ty;
+            if (first[t + 1] > first[t])
+                batch.push_back(t);
+        }
+
+    auto live = [&](size_t task){
+        const size_t t = batch[task];
+        current.live(static_cast<Environment*>(this),
+                     current.members.data() + first[t], first[t + 1] - first[t],
+                     tiles.births[t], seed, stepsTaken, tiles.totals[t]);
+    };
+    runTasks(batch.size(), live);
+}
+
+void Cluster::applyTiles(tiling& tiles, vector<Bacterium>& births){
+    for (size_t t = 0; t < tiles.totals.size(); t++){
+        totalNutrientLevel -= tiles.totals[t].nutrientConsumed;
+        totalAcetateLevel += tiles.totals[t].acetateReleased;
+        CO2Level += tiles.totals[t].CO2Released;
+        for (Bacterium& individual : tiles.births[t])
+            births.push_back(std::move(individual));
+    }
+}
+
+void Cluster::setThreads(unsigned int threads){
+    if (threads == 0)
+        pool.reset();
+    else
+        pool.reset(new TaskPool(threads));
+    tasks = pool.get();
+}
+
+void Cluster::removeDead(){
+    // one sweep per population, keeping the survivors in their original order
+    for (population& current : populations){
+        vector<Bacterium>& members = current.members;
+        size_t kept = 0;
+        for (size_t i = 0; i < members.size(); ++i){
+            if (members[i].isAlive()){
+                if (kept != i)
+                    members[kept] = std::move(members[i]);
+                kept++;
+            }
+            else
+                bury(members[i]);
+        }
+        members.erase(members.begin() + kept, members.end());
+    }
+}
+
+void Cluster::simulate(unsigned long int steps, GoldenTrace* trace){
+    for (unsigned long int timeStep = 1;
+         timeStep <= steps && totalAliveBacteria > 0; timeStep++){
+        step();
+        if (trace != nullptr)
+            trace->steps.push_back(state(timeStep));
+    }
+}
+
+StepState Cluster::state(unsigned long int timeStep){
+    StepState current;
+    current.step = timeStep;
+    current.aliveBacteria = totalAliveBacteria;
+    current.totalBacteria = totalBacteria;
+    current.CO2Level = getCO2Level();
+    current.fieldHash = checksum(current.nutrientSum, current.acetateSum);
+
+    vector<pair<unsigned long int, double>> energies;
+    energies.reserve(totalAliveBacteria);
+    for (population& strain : populations)
+        for (Bacterium& individual : strain.members)
+            energies.push_back({individual.getID(), individual.getEnergy()});
+    sort(energies.begin(), energies.end());
+    for (const auto& energy : energies)
+        current.energySum += energy.second;
+
+    return current;
+}
+
+void Cluster::enableLiveFeed(const string& name, bool keepVisFile){
+    liveFeed.reset(new LiveFeed(name, ranges[0], ranges[1]));
+    writeVisFile = keepVisFile;
+}
+
+void Cluster::enableDeathLog(const string& filename){
+    deathLog.reset(new DeathLog(filename));
+}
+
+void Cluster::setFieldExport(const ExportSettings& settings){
+    fieldExport = settings;
+}
+
+void Cluster::updateTemporalResolution(double newResolution){
+    Environment::updateTemporalResolution(newResolution);
+    Bacterium::updateTemporalResolution(newResolution);
+}
+
+// The status display only redraws when stdout is a terminal
+static bool isInteractive(){
+#ifdef _WIN32
+    return _isatty(_fileno(stdout));
+#else
+    return isatty(fileno(stdout));
+#endif
+}
+
+static RunAnalytics::sample toSample(const Cluster::snapshot& current){
+    return { current.timeElapsed, current.aliveBacteria, current.totalBacteria,
+             current.CO2Level, current.nutrientLevel, current.acetateLevel };
+}
+
+static void printStatus(const Cluster::snapshot& current, double maxTime){
+    cout << "Simulation Data:\n================\n";
+    cout << fixed << setprecision(2);
+    cout << "Time Elapsed   : " << current.timeElapsed << " / " << maxTime << "\n";
+    cout << "Alive Bacteria : " << current.aliveBacteria << "\n";
+    cout << "Total Bacteria : " << current.totalBacteria << "\n";
+    cout << "Net CO2 Level  : " << current.CO2Level << "\n";
+    cout << "Total Nutrient : " << current.nutrientLevel << "\n";
+    cout << "Total Acetate  : " << current.acetateLevel << "\n";
+    cout << flush;
+}
+
+Cluster::snapshot Cluster::capture(unsigned long int timeStep,
+                                   double timeElapsed, bool withFrame,
+                                   const FieldPyramid* fields){
+    snapshot current;
+    current.timeStep = timeStep;
+    current.timeElapsed = timeElapsed;
+    current.aliveBacteria = totalAliveBacteria;
+    current.totalBacteria = totalBacteria;
+    current.CO2Level = getCO2Level();
+    current.nutrientLevel = getNutrientLevel();
+    current.acetateLevel = getAcetateLevel();
+
+    if (populations.size() > 1)
+        for (const population& strain : populations)
+            current.aliveByStrain.push_back(strain.members.size());
+
+    // only what the export view needs is copied, the slice view gets a
+    // few planes and the projection a single one whatever the grid size
+    if (fields){
+        FieldPyramid::level& level = current.fields;
+        current.hasFields = true;
+        level.nx = ranges[0];
+        level.ny = ranges[1];
+        level.nz = ranges[2];
+
+        if (fieldExport.view == ExportSettings::slice){
+            fields->slab(current.firstPlane, level.nz);
+            copyFields(level.nutrient, level.acetate, current.firstPlane,
+                       level.nz);
+        }
+        else if (fieldExport.view == ExportSettings::projection){
+            level.nz = 1;
+            projectFields(level.nutrient, level.acetate);
+        }
+        else
+            copyFields(level.nutrient, level.acetate);
+    }
+
+    if (!withFrame)
+        return current;
+
+    // the vis frame shows the middle plane of the grid
+    current.hasFrame = true;
+    int zSlice = ranges[2] / 2;
+    current.nutrientSlice.reserve(ranges[0] * ranges[1]);
+    current.acetateSlice.reserve(ranges[0] * ranges[1]);
+    for (int x = 0; x < ranges[0]; x++)
+        for (int y = 0; y < ranges[1]; y++){
+            current.nutrientSlice.push_back(cell(x, y, zSlice).nutrientLevel);
+            current.acetateSlice.push_back(cell(x, y, zSlice).acetateLevel);
+        }
+
+    current.alivePositions.reserve(2 * totalAliveBacteria);
+    for (population& strain : populations)
+        for (Bacterium& b : strain.members){
+            vector<int> pos = b.getPosition();
+            current.alivePositions.push_back(pos[0]);
+            current.alivePositions.push_back(pos[1]);
+        }
+    // deaths are shown per column, summed over z
+    if (deathColumns.empty())
+        current.deathColumns.assign(size_t(ranges[0]) * ranges[1], 0);
+    else
+        current.deathColumns = deathColumns;
+
+    return current;
+}
+
+void Cluster::run(string filename){
+    run(filename, 2000.0);
+}
+
+const RunAnalytics& Cluster::getAnalytics() const{
+    return analytics;
+}
+
+void Cluster::run(string filename, double maxTime){
+    string mainFile = "../results/" + filename;
+    ofstream file(mainFile);
+    string summaryFile = "../results/" + filename.substr(0, filename.rfind('.'))
+                       + "-summary.csv";
+
+    string visFile = "../results/vis_data.csv";
+    ofstream vfile;
+    if (writeVisFile)
+        vfile.open(visFile);
+
+    if (!file.is_open() || (writeVisFile && !vfile.is_open())){
+        throw runtime_error("Could not open files for writing.");
+    }
+
+    file << "TimeElapsed,AliveBacteria,TotalBacteria,NetCO2,TotalNutrient,TotalAcetate";
+    if (populations.size() > 1)
+        for (const population& strain : populations)
+            file << ",Alive_" << strain.strain;
+    file << "\n";
+
+    unsigned long int timeStep = 0;
+    double timeElapsed = 0.0f;
+    double tempres = Bacterium::getTemporalResolution();
+    
+    const int visFrequency = 5; 
+    const int ny = ranges[1];
+
+    unique_ptr<FieldPyramid> pyramid;
+    if (fieldExport.cadence > 0)
+        pyramid.reset(new FieldPyramid(fieldExport, ranges[0], ranges[1],
+                                       ranges[2]));
+
+    // The simulation runs on this thread and publishes a snapshot of every
+    // step. Writing the output and redrawing the status happen on their own
+    // threads, so they overlap with the next steps.
+    BoundedQueue<snapshot> published(16);
+
+    // at most one field export is in flight, so a volume export holds a
+    // single copy of the grid however far the writer falls behind
+    mutex fieldLock;
+    condition_variable fieldWake;
+    bool fieldsPending = false;
+
+    mutex statusLock;
+    condition_variable statusWake;
+    snapshot latest;
+    bool updated = false, finished = false;
+    const bool interactive = isInteractive();
+
+    // the statistics start from the state before the first step
+    analytics = RunAnalytics();
+    analytics.observe(toSample(capture(0, 0.0f, false)));
+
+    // everything one snapshot adds to the output files and the live feed
+    auto writeOutput = [&](snapshot& current){
+        file << current.timeElapsed << "," << current.aliveBacteria << ","
+             << current.totalBacteria << "," << current.CO2Level << ","
+             << current.nutrientLevel << "," << current.acetateLevel;
+        for (unsigned long int count : current.aliveByStrain)
+            file << "," << count;
+        file << "\n";
+
+        if (current.hasFrame && liveFeed)
+            liveFeed->publish(current.timeStep, current.timeElapsed,
+                              current.aliveBacteria, current.nutrientSlice,
+                              current.acetateSlice, current.alivePositions);
+
+        if (current.hasFrame && writeVisFile){
+            const unsigned long int t = current.timeStep;
+            for (size_t n = 0; n < current.nutrientSlice.size(); n++){
+                int x = n / ny, y = n % ny;
+                double nut = current.nutrientSlice[n];
+                double ace = current.acetateSlice[n];
+
+                if(nut > 1.0) vfile << t << ",0," << x << "," << y << "," << nut << "\n";
+                if(ace > 1.0) vfile << t << ",1," << x << "," << y << "," << ace << "\n";
+            }
+            for (size_t n = 0; n < current.alivePositions.size(); n += 2)
+                vfile << t << ",2," << current.alivePositions[n] << ","
+                      << current.alivePositions[n + 1] << ",1\n";
+            for (size_t n = 0; n < current.deathColumns.size(); n++)
+                if (current.deathColumns[n] > 0)
+                    vfile << t << ",3," << n / ny << "," << n % ny << ","
+                          << current.deathColumns[n] << "\n";
+        }
+
+        if (current.hasFields){
+            pyramid->write(current.timeStep, std::move(current.fields),
+                           current.firstPlane);
+            lock_guard<mutex> guard(fieldLock);
+            fieldsPending = false;
+            fieldWake.notify_one();
+        }
+
+        if (!file || (writeVisFile && !vfile))
+            throw runtime_error("Error: could not write " + mainFile +
+                                " or " + visFile + ".");
+    };
+
+    // an exception on the writer (a full disk, a bad export) stops the
+    // run and is rethrown here once the output threads are down
+    exception_ptr writerError;
+    atomic<bool> writerFailed{false};
+
+    thread writer([&]{
+        try{
+            snapshot current;
+            while (published.pop(current)){
+                analytics.observe(toSample(current));
+                writeOutput(current);
+
+                lock_guard<mutex> guard(statusLock);
+                latest = std::move(current);
+                updated = true;
+            }
+        }
+        catch (...){
+            writerError = current_exception();
+            writerFailed = true;
+            published.close();
+            lock_guard<mutex> guard(fieldLock);
+            fieldsPending = false;
+            fieldWake.notify_one();
+        }
+    });
+
+    // redraws at most 10 times a second, and only on a terminal
+    thread display;
+    if (interactive){
+        cout << "\033[2J"; 
+        display = thread([&]{
+            unique_lock<mutex> guard(statusLock);
+            while (!finished){
+                statusWake.wait_for(guard, chrono::milliseconds(100));
+                if (updated){
+                    cout << "\033[H";
+                    printStatus(latest, maxTime);
+                    updated = false;
+                }
+            }
+        });
+    }
+
+    auto stopOutput = [&]{
+        published.close();
+        writer.join();
+        {
+            lock_guard<mutex> guard(statusLock);
+            finished = true;
+        }
+        statusWake.notify_all();
+        if (display.joinable())
+            display.join();
+    };
+
+    if (pool)
+        pool->resetUtilisation();
+
+    try{
+        while (!writerFailed && totalAliveBacteria > 0 && timeElapsed < maxTime){
+            step(); 
+            timeStep++;
+            timeElapsed = timeStep * tempres;
+
+            const bool exportFields = pyramid && timeStep % fieldExport.cadence == 0;
+            if (exportFields){
+                unique_lock<mutex> guard(fieldLock);
+                fieldWake.wait(guard, [&]{ return !fieldsPending || writerFailed; });
+                fieldsPending = true;
+            }
+
+            published.push(capture(timeStep, timeElapsed,
+                                   timeStep % visFrequency == 0,
+                                   exportFields ? pyramid.get() : nullptr));
+        }
+    }
+    catch (...){
+        stopOutput();
+        throw;
+    }
+    stopOutput();
+    if (writerError)
+        rethrow_exception(writerError);
+
+    // the final state is always shown once, without escape codes when
+    // stdout is not a terminal
+    if (interactive)
+        cout << "\033[H";
+    printStatus(latest, maxTime);
+    cout << "Peak Bacteria  : " << analytics.getPeakPopulation() << " at "
+         << analytics.getTimeToPeak() << "\n";
+    cout << "Doubling Time  : " << analytics.getDoublingTime() << "\n";
+    if (pool){
+        analytics.setThreadUtilisation(pool->utilisation());
+        // formatted apart, so cout keeps its precision
+        ostringstream shares;
+        shares << fixed << setprecision(0);
+        for (double share : pool->utilisation())
+            shares << " " << 100 * share << "%";
+        cout << "Thread Use     :" << shares.str() << endl;
+    }
+
+    file.close();
+    if (writeVisFile)
+        vfile.close();
+    analytics.write(summaryFile);
+}
@@ -0,0 +1,34 @@
+#include <cstring>
+#include <stdexcept>
+#include "DeathLog.h"
+using namespace std;
+
+
+DeathLog::DeathLog(const string& filename)
+    : file(filename, ios::binary | ios::trunc)
+{
+    if (!file.is_open())
+        throw runtime_error("Could not open " + filename + " for writing.");
+    file.write("BIOSIMDL", 8);
+}
+
+
+void DeathLog::append(unsigned long int id, unsigned long int step,
+                      const vector<int>& position,
+                      Bacterium::deathCause cause)
+{
+    unsigned char record[recordBytes] = {};
+
+    uint64_t id64 = id;
+    uint32_t step32 = step;
+    int16_t xyz[3] = { static_cast<int16_t>(position[0]),
+                       static_cast<int16_t>(position[1]),
+                       static_cast<int16_t>(position[2]) };
+
+    memcpy(record, &id64, 8);
+    memcpy(record + 8, &step32, 4);
+    memcpy(record + 12, xyz, 6);
+    record[18] = cause;
+
+    file.write(reinterpret_cast<const char*>(record), recordBytes);
+}
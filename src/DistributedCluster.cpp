@@ -0,0 +1,540 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include "DistributedCluster.h"
+#include "Random.h"
+using namespace std;
+
+
+// halo planes a bacterium on the edge of a slab reaches into
+static const int halo = Bacterium::reach<StandardStrain>();
+
+// the slab of x planes owned by rank r out of ranks. Slabs are whole
+// columns of the tiles of Cluster::binTiles, which are twice the reach wide
+static void slab(int nx, int r, int ranks, int& begin, int& end){
+    const int size = 2 * halo;
+    const long columns = (nx + size - 1) / size;
+    begin = min(nx, size * int((columns * r) / ranks));
+    end = min(nx, size * int((columns * (r + 1)) / ranks));
+}
+
+// size of the local grid of rank r - its slab plus the halos
+static vector<int> localSize(MPI_Comm communicator, vector<int> gridSize){
+    int r, n, begin, end;
+    MPI_Comm_rank(communicator, &r);
+    MPI_Comm_size(communicator, &n);
+    slab(gridSize.at(0), r, n, begin, end);
+    gridSize[0] = end - begin + (r > 0 ? halo : 0) + (r < n - 1 ? halo : 0);
+    return gridSize;
+}
+
+// bacteria are sent between ranks as raw records
+static MPI_Datatype recordType(){
+    static MPI_Datatype type = MPI_DATATYPE_NULL;
+    if (type == MPI_DATATYPE_NULL){
+        MPI_Type_contiguous(sizeof(Bacterium::record), MPI_BYTE, &type);
+        MPI_Type_commit(&type);
+    }
+    return type;
+}
+
+
+DistributedCluster::DistributedCluster(MPI_Comm communicator, int numBacteria,
+                                       vector<int> gridSize, double energyValue)
+    : Cluster(0, 1, energyValue, localSize(communicator, gridSize)),
+      comm(communicator), globalSize(gridSize)
+{
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &ranks);
+    slab(globalSize[0], rank, ranks, ownedBegin, ownedEnd);
+
+    haloLow = rank > 0 ? halo : 0;
+    haloHigh = rank < ranks - 1 ? halo : 0;
+    // a slab has to hold the halo its neighbours reach into it. The check
+    // is over all slabs so every rank throws
+    for (int r = 0; ranks > 1 && r < ranks; r++){
+        int begin, end;
+        slab(globalSize[0], r, ranks, begin, end);
+        if (end - begin < halo)
+            throw invalid_argument("Error: too many ranks, every slab needs at "
+                                   "least " + to_string(halo) + " x planes.");
+    }
+
+    origin = {ownedBegin - haloLow, 0, 0};
+    extent = globalSize;
+
+    // the totals are over the whole chamber, summed per plane and then in
+    // plane order as the Environment constructor does
+    const int owned = ownedEnd - ownedBegin;
+    vector<long double> planes(2 * size_t(owned));
+    for (int i = 0; i < owned; i++){
+        long double nutrientSum = 0.0f, acetateSum = 0.0f;
+        for (int j = 0; j < ranges[1]; j++)
+          for (int k = 0; k < ranges[2]; k++){
+            nutrientSum += cell(haloLow + i, j, k).nutrientLevel;
+            acetateSum += cell(haloLow + i, j, k).acetateLevel;
+          }
+        planes[2 * i] = nutrientSum;
+        planes[2 * i + 1] = acetateSum;
+    }
+
+    vector<int> counts(ranks), offsets(ranks);
+    for (int r = 0; r < ranks; r++){
+        int begin, end;
+        slab(globalSize[0], r, ranks, begin, end);
+        counts[r] = 2 * (end - begin);
+        offsets[r] = 2 * begin;
+    }
+    vector<long double> allPlanes(2 * size_t(globalSize[0]));
+    MPI_Allgatherv(planes.data(), planes.size(), MPI_LONG_DOUBLE,
+                   allPlanes.data(), counts.data(), offsets.data(),
+                   MPI_LONG_DOUBLE, comm);
+
+    totalNutrientLevel = 0.0f;
+    totalAcetateLevel = 0.0f;
+    for (int i = 0; i < globalSize[0]; i++){
+        totalNutrientLevel += allPlanes[2 * i];
+        totalAcetateLevel += allPlanes[2 * i + 1];
+    }
+
+    // every rank draws the whole initial population from the same seed,
+    // as Cluster would, and keeps the bacteria inside its slab. From then
+    // on every bacterium draws from its own stream of the seed
+    unsigned int seed = RandomGenerator::runSeed();
+    MPI_Bcast(&seed, 1, MPI_UNSIGNED, 0, comm);
+    RandomGenerator::setSeed(seed);
+
+    vector<Bacterium>& alive = populations[0].members;
+    for (Bacterium& individual : seedPopulation(numBacteria, energyValue,
+                                                globalSize, 1, 1)){
+        int x = individual.getPosition()[0];
+        bool mine = x >= ownedBegin &&
+                    (x < ownedEnd || rank == ranks - 1);
+        if (mine){
+            alive.push_back(std::move(individual));
+            totalAliveBacteria++;
+            totalBacteria++;
+        }
+    }
+    nextID = numBacteria + 1;
+}
+
+
+void DistributedCluster::packPlanes(int first, int count,
+                                    vector<double>& buffer) const{
+    buffer.clear();
+    buffer.reserve(2 * size_t(count) * ranges[1] * ranges[2]);
+    for (int i = first; i < first + count; i++)
+      for (int j = 0; j < ranges[1]; j++)
+        for (int k = 0; k < ranges[2]; k++){
+            buffer.push_back(cell(i, j, k).nutrientLevel);
+            buffer.push_back(cell(i, j, k).acetateLevel);
+        }
+}
+
+
+void DistributedCluster::unpackPlanes(int first, int count,
+                                      const vector<double>& buffer){
+    size_t n = 0;
+    for (int i = first; i < first + count; i++)
+      for (int j = 0; j < ranges[1]; j++)
+        for (int k = 0; k < ranges[2]; k++, n += 2){
+            patch& p = cell(i, j, k);
+            p.nutrientLevel = buffer[n];
+            p.acetateLevel = buffer[n + 1];
+        }
+}
+
+
+void DistributedCluster::exchangeHalos(){
+    const int left = rank > 0 ? rank - 1 : MPI_PROC_NULL;
+    const int right = rank < ranks - 1 ? rank + 1 : MPI_PROC_NULL;
+    const int owned = ownedEnd - ownedBegin;
+    vector<double> sendBuffer, receiveBuffer;
+
+    // first owned planes go to the high halo of the left neighbour
+    packPlanes(haloLow, haloLow, sendBuffer);
+    receiveBuffer.resize(2 * size_t(haloHigh) * ranges[1] * ranges[2]);
+    MPI_Sendrecv(sendBuffer.data(), sendBuffer.size(), MPI_DOUBLE, left, 0,
+                 receiveBuffer.data(), receiveBuffer.size(), MPI_DOUBLE,
+                 right, 0, comm, MPI_STATUS_IGNORE);
+    unpackPlanes(haloLow + owned, haloHigh, receiveBuffer);
+
+    // last owned planes go to the low halo of the right neighbour
+    packPlanes(haloLow + owned - haloHigh, haloHigh, sendBuffer);
+    receiveBuffer.resize(2 * size_t(haloLow) * ranges[1] * ranges[2]);
+    MPI_Sendrecv(sendBuffer.data(), sendBuffer.size(), MPI_DOUBLE, right, 1,
+                 receiveBuffer.data(), receiveBuffer.size(), MPI_DOUBLE,
+                 left, 1, comm, MPI_STATUS_IGNORE);
+    unpackPlanes(0, haloLow, receiveBuffer);
+}
+
+
+void DistributedCluster::returnHalos(int parity){
+    const int left = rank > 0 ? rank - 1 : MPI_PROC_NULL;
+    const int right = rank < ranks - 1 ? rank + 1 : MPI_PROC_NULL;
+    const int owned = ownedEnd - ownedBegin;
+    const int size = 2 * halo;              // tile edge, see slab()
+    vector<double> sendBuffer, receiveBuffer;
+
+    // the two tile columns at a border have different parity, so in one
+    // colour either this rank or its neighbour ran next to it and the
+    // other did not touch the planes there. The owner takes them as sent
+    const bool lowRan = (ownedBegin / size) % 2 == parity;
+    const bool highRan = ((ownedEnd - 1) / size) % 2 == parity;
+
+    // the high halo is the first planes of the right rank
+    sendBuffer.clear();
+    if (highRan)
+        packPlanes(haloLow + owned, haloHigh, sendBuffer);
+    receiveBuffer.resize(lowRan ? 0 : 2 * size_t(haloLow) * ranges[1] * ranges[2]);
+    MPI_Sendrecv(sendBuffer.data(), sendBuffer.size(), MPI_DOUBLE,
+                 highRan ? right : MPI_PROC_NULL, 2,
+                 receiveBuffer.data(), receiveBuffer.size(), MPI_DOUBLE,
+                 lowRan ? MPI_PROC_NULL : left, 2, comm, MPI_STATUS_IGNORE);
+    if (!lowRan)
+        unpackPlanes(haloLow, haloLow, receiveBuffer);
+
+    // the low halo is the last planes of the left rank
+    sendBuffer.clear();
+    if (lowRan)
+        packPlanes(0, haloLow, sendBuffer);
+    receiveBuffer.resize(highRan ? 0 : 2 * size_t(haloHigh) * ranges[1] * ranges[2]);
+    MPI_Sendrecv(sendBuffer.data(), sendBuffer.size(), MPI_DOUBLE,
+                 lowRan ? left : MPI_PROC_NULL, 3,
+                 receiveBuffer.data(), receiveBuffer.size(), MPI_DOUBLE,
+                 highRan ? MPI_PROC_NULL : right, 3, comm, MPI_STATUS_IGNORE);
+    if (!highRan)
+        unpackPlanes(haloLow + owned - haloHigh, haloHigh, receiveBuffer);
+}
+
+
+void DistributedCluster::reduceTiles(tiling& tiles){
+    const size_t count = tiles.totals.size();
+    vector<long double> local(3 * count), global(3 * count);
+    for (size_t t = 0; t < count; t++){
+        local[3 * t] = tiles.totals[t].nutrientConsumed;
+        local[3 * t + 1] = tiles.totals[t].acetateReleased;
+        local[3 * t + 2] = tiles.totals[t].CO2Released;
+    }
+
+    // every other rank adds zeros, so the sums are exact
+    MPI_Allreduce(local.data(), global.data(), local.size(), MPI_LONG_DOUBLE,
+                  MPI_SUM, comm);
+
+    for (size_t t = 0; t < count; t++){
+        tiles.totals[t].nutrientConsumed = global[3 * t];
+        tiles.totals[t].acetateReleased = global[3 * t + 1];
+        tiles.totals[t].CO2Released = global[3 * t + 2];
+    }
+}
+
+
+void DistributedCluster::buryDead(){
+    const int left = rank > 0 ? rank - 1 : MPI_PROC_NULL;
+    const int right = rank < ranks - 1 ? rank + 1 : MPI_PROC_NULL;
+    vector<Bacterium>& alive = populations[0].members;
+
+    // deaths on a halo patch are recorded by the owner of the patch, they
+    // are few, so they go as (x, y, z, remains) quadruples
+    vector<double> toLeft, toRight;
+    for (Bacterium& individual : alive){
+        if (individual.isAlive())
+            continue;
+        const int x = individual.getCoordinate(0);
+        vector<double>& outgoing = x < ownedBegin ? toLeft : toRight;
+        if (x < ownedBegin || x >= ownedEnd)
+            outgoing.insert(outgoing.end(),
+                            {double(x), double(individual.getCoordinate(1)),
+                             double(individual.getCoordinate(2)),
+                             max(0.0, individual.getEnergy())});
+    }
+
+    auto exchange = [&](const vector<double>& outgoing, int to, int from,
+                        int tag){
+        unsigned long int sendCount = outgoing.size(), receiveCount = 0;
+        MPI_Sendrecv(&sendCount, 1, MPI_UNSIGNED_LONG, to, tag,
+                     &receiveCount, 1, MPI_UNSIGNED_LONG, from, tag,
+                     comm, MPI_STATUS_IGNORE);
+
+        vector<double> incoming(receiveCount);
+        MPI_Sendrecv(outgoing.data(), sendCount, MPI_DOUBLE, to, tag + 1,
+                     incoming.data(), receiveCount, MPI_DOUBLE, from,
+                     tag + 1, comm, MPI_STATUS_IGNORE);
+        return incoming;
+    };
+    const vector<double> fromRight = exchange(toLeft, left, right, 8);
+    const vector<double> fromLeft = exchange(toRight, right, left, 10);
+
+    auto record = [&](const vector<double>& deaths){
+        for (size_t n = 0; n < deaths.size(); n += 4)
+            recordDeath({int(deaths[n]), int(deaths[n + 1]),
+                         int(deaths[n + 2])}, deaths[n + 3]);
+    };
+
+    // Cluster::removeDead buries in tile order, in which the bacteria of
+    // the left rank come before this rank's and the right rank's after
+    record(fromLeft);
+    size_t kept = 0;
+    for (size_t i = 0; i < alive.size(); ++i){
+        if (alive[i].isAlive()){
+            if (kept != i)
+                alive[kept] = std::move(alive[i]);
+            kept++;
+            continue;
+        }
+        const int x = alive[i].getCoordinate(0);
+        if (x >= ownedBegin && x < ownedEnd)
+            bury(alive[i]);
+        else{
+            totalDeadBacteria++;
+            totalAliveBacteria--;
+        }
+    }
+    alive.erase(alive.begin() + kept, alive.end());
+    record(fromRight);
+}
+
+
+void DistributedCluster::registerBirths(vector<Bacterium>& births){
+    // IDs continue the global count, ranks take consecutive blocks
+    unsigned long int count = births.size(), offset = 0, all = 0;
+    MPI_Exscan(&count, &offset, 1, MPI_UNSIGNED_LONG, MPI_SUM, comm);
+    MPI_Allreduce(&count, &all, 1, MPI_UNSIGNED_LONG, MPI_SUM, comm);
+    if (rank == 0)
+        offset = 0;
+
+    vector<Bacterium>& alive = populations[0].members;
+    for (size_t i = 0; i < births.size(); i++){
+        births[i].setID(nextID + offset + i);
+        alive.push_back(std::move(births[i]));
+        totalBacteria++;
+        totalAliveBacteria++;
+    }
+    nextID += all;
+}
+
+
+void DistributedCluster::migrate(){
+    const int left = rank > 0 ? rank - 1 : MPI_PROC_NULL;
+    const int right = rank < ranks - 1 ? rank + 1 : MPI_PROC_NULL;
+    vector<Bacterium::record> toLeft, toRight;
+    vector<Bacterium>& alive = populations[0].members;
+
+    // a bacterium moves at most movementSpeed planes per step, so it can
+    // only have crossed into a direct neighbour
+    size_t kept = 0;
+    for (size_t i = 0; i < alive.size(); ++i){
+        int x = alive[i].getPosition()[0];
+        if (x < ownedBegin && left != MPI_PROC_NULL)
+            toLeft.push_back(alive[i].save());
+        else if (x >= ownedEnd && right != MPI_PROC_NULL)
+            toRight.push_back(alive[i].save());
+        else{
+            if (kept != i)
+                alive[kept] = std::move(alive[i]);
+            kept++;
+        }
+    }
+    alive.erase(alive.begin() + kept, alive.end());
+    totalAliveBacteria -= toLeft.size() + toRight.size();
+    totalBacteria -= toLeft.size() + toRight.size();
+
+    auto exchange = [&](vector<Bacterium::record>& outgoing, int to,
+                        int from, int tag){
+        unsigned long int sendCount = outgoing.size(), receiveCount = 0;
+        MPI_Sendrecv(&sendCount, 1, MPI_UNSIGNED_LONG, to, tag,
+                     &receiveCount, 1, MPI_UNSIGNED_LONG, from, tag,
+                     comm, MPI_STATUS_IGNORE);
+
+        vector<Bacterium::record> incoming(receiveCount);
+        MPI_Sendrecv(outgoing.data(), sendCount, recordType(), to, tag + 1,
+                     incoming.data(), receiveCount, recordType(), from,
+                     tag + 1, comm, MPI_STATUS_IGNORE);
+
+        for (const Bacterium::record& saved : incoming)
+            alive.emplace_back(saved);
+        totalAliveBacteria += receiveCount;
+        totalBacteria += receiveCount;
+    };
+
+    exchange(toLeft, left, right, 4);
+    exchange(toRight, right, left, 6);
+}
+
+
+void DistributedCluster::step(){
+    vector<Bacterium> newMembers;
+    stepsTaken++;
+
+    // the tiles run colour by colour as in Cluster::step, with the halo
+    // planes a colour changed handed back and the halos refreshed after
+    // each, so no rank works on a stale copy of a neighbour's patches
+    tiling tiles = binTiles(0);
+    exchangeHalos();
+    for (int colour = 0; colour < 4; colour++){
+        liveColour(0, tiles, colour);
+        returnHalos(colour % 2);
+        exchangeHalos();
+    }
+    diffuse();
+
+    reduceTiles(tiles);
+    applyTiles(tiles, newMembers);
+    buryDead();
+    registerBirths(newMembers);
+    migrate();
+}
+
+
+DistributedCluster::totals DistributedCluster::reduce(){
+    totals global;
+    unsigned long int counts[2] = {totalAliveBacteria,
+                                   totalAliveBacteria + totalDeadBacteria};
+    unsigned long int globalCounts[2];
+    MPI_Allreduce(counts, globalCounts, 2, MPI_UNSIGNED_LONG, MPI_SUM, comm);
+
+    global.aliveBacteria = globalCounts[0];
+    global.totalBacteria = globalCounts[1];
+    // every rank applies the totals of all tiles, see reduceTiles
+    global.nutrientLevel = totalNutrientLevel;
+    global.acetateLevel = totalAcetateLevel;
+    global.CO2Level = CO2Level;
+    return global;
+}
+
+
+void DistributedCluster::simulate(unsigned long int steps, GoldenTrace* trace){
+    for (unsigned long int timeStep = 1;
+         timeStep <= steps && reduce().aliveBacteria > 0; timeStep++){
+        step();
+        if (trace != nullptr)
+            trace->steps.push_back(state(timeStep));
+    }
+}
+
+
+StepState DistributedCluster::state(unsigned long int timeStep){
+    StepState current;
+    totals global = reduce();
+    current.step = timeStep;
+    current.aliveBacteria = global.aliveBacteria;
+    current.totalBacteria = global.totalBacteria;
+    current.CO2Level = global.CO2Level;
+
+    // the owned planes of the ranks, in rank order, are the whole grid
+    const int owned = ownedEnd - ownedBegin;
+    const int planeSize = 2 * ranges[1] * ranges[2];
+    vector<double> mine;
+    packPlanes(haloLow, owned, mine);
+
+    vector<int> counts(ranks), offsets(ranks);
+    for (int r = 0; r < ranks; r++){
+        int begin, end;
+        slab(globalSize[0], r, ranks, begin, end);
+        counts[r] = (end - begin) * planeSize;
+        offsets[r] = begin * planeSize;
+    }
+    vector<double> whole(rank == 0 ? size_t(globalSize[0]) * planeSize : 0);
+    MPI_Gatherv(mine.data(), mine.size(), MPI_DOUBLE, whole.data(),
+                counts.data(), offsets.data(), MPI_DOUBLE, 0, comm);
+
+    // and the alive bacteria, for the energy sum in ID order
+    vector<Bacterium::record> records;
+    for (const Bacterium& individual : populations[0].members)
+        records.push_back(individual.save());
+    int count = records.size();
+    MPI_Gather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+    int all = 0;
+    for (int r = 0; r < ranks; r++){
+        offsets[r] = all;
+        all += counts[r];
+    }
+    vector<Bacterium::record> everyone(rank == 0 ? all : 0);
+    MPI_Gatherv(records.data(), count, recordType(), everyone.data(),
+                counts.data(), offsets.data(), recordType(), 0, comm);
+
+    if (rank != 0)
+        return current;
+
+    vector<patch> grid(whole.size() / 2);
+    for (size_t n = 0; n < grid.size(); n++)
+        grid[n] = {whole[2 * n], whole[2 * n + 1]};
+    current.fieldHash = checksum(grid.data(), grid.size(), current.nutrientSum,
+                                 current.acetateSum);
+
+    sort(everyone.begin(), everyone.end(),
+         [](const Bacterium::record& a, const Bacterium::record& b){
+             return a.id < b.id;
+         });
+    for (const Bacterium::record& saved : everyone)
+        current.energySum += saved.energy;
+    return current;
+}
+
+
+void DistributedCluster::run(string filename, double maxTime){
+    // the same settings on every rank, so they all throw
+    if (liveFeed)
+        throw invalid_argument("Error: the live feed is not supported in distributed mode.");
+    if (fieldExport.cadence > 0)
+        throw invalid_argument("Error: the field export is not supported in distributed mode.");
+    if (deathLog)
+        throw invalid_argument("Error: the death log is not supported in distributed mode.");
+    if (populations.size() > 1)
+        throw invalid_argument("Error: only the standard strain is supported in distributed mode.");
+
+    ofstream file;
+    string summaryFile = "../results/" + filename.substr(0, filename.rfind('.'))
+                       + "-summary.csv";
+    if (rank == 0){
+        file.open("../results/" + filename);
+        if (!file.is_open())
+            throw runtime_error("Could not open files for writing.");
+        file << "TimeElapsed,AliveBacteria,TotalBacteria,NetCO2,TotalNutrient,TotalAcetate\n";
+    }
+
+    unsigned long int timeStep = 0;
+    double timeElapsed = 0.0f;
+    double tempres = Bacterium::getTemporalResolution();
+    totals global = reduce();
+
+    // rank 0 keeps the statistics of the global totals, as Cluster::run does
+    auto observe = [&](){
+        analytics.observe({timeElapsed, global.aliveBacteria,
+                           global.totalBacteria, global.CO2Level,
+                           (double)global.nutrientLevel,
+                           (double)global.acetateLevel});
+    };
+    analytics = RunAnalytics();
+    observe();
+
+    while (global.aliveBacteria > 0 && timeElapsed < maxTime){
+        step();
+        timeStep++;
+        timeElapsed = timeStep * tempres;
+
+        global = reduce();
+        if (rank == 0){
+            file << timeElapsed << "," << global.aliveBacteria << ","
+                 << global.totalBacteria << "," << global.CO2Level << ","
+                 << (double)global.nutrientLevel << ","
+                 << (double)global.acetateLevel << "\n";
+            observe();
+        }
+    }
+
+    if (rank != 0)
+        return;
+
+    cout << "Ran " << timeStep << " steps on " << ranks << " ranks, "
+         << global.aliveBacteria << " of " << global.totalBacteria
+         << " bacteria alive" << endl;
+    cout << "Peak Bacteria  : " << analytics.getPeakPopulation() << " at "
+         << analytics.getTimeToPeak() << "\n";
+    cout << "Doubling Time  : " << analytics.getDoublingTime() << endl;
+
+    file.close();
+    analytics.write(summaryFile);
+}
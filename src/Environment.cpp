@@ -1,213 +1,382 @@
-#include "Environment.h"
-#include <stdexcept>
-#include "Random.h"
-using namespace std;
-
-Environment::patch::patch() {}
-
-
-Environment::Environment(int randomiseType, vector<int> rangesValue,
-                         double nutrientValue, double acetateValue,
-                         double tempres){
-  if (rangesValue.size() != 3)
-    throw invalid_argument("Error: rangesValue must be a 3-element vector.");
-
-  ranges = rangesValue;
-
-  locale.resize(ranges[0], vector<vector<patch>>(ranges[1],
-                vector<patch>(ranges[2])));
-
-  RandomGenerator rangen;
-
-  switch (randomiseType){
-    case 0:
-      for (int i = 0; i < ranges[0]; i++)
-       for (int j = 0; j < ranges[1]; j++)
-        for (int k = 0; k < ranges[2]; k++)
-        {
-          locale[i][j][k].nutrientLevel = nutrientValue;
-          totalNutrientLevel += locale[i][j][k].nutrientLevel;
-          locale[i][j][k].acetateLevel = acetateValue;
-          totalAcetateLevel += locale[i][j][k].acetateLevel;
-        }
-      break;
-
-    case 1:
-      for (int i = 0; i < ranges[0]; i++)
-       for (int j = 0; j < ranges[1]; j++)
-        for (int k = 0; k < ranges[2]; k++){
-          locale[i][j][k].nutrientLevel =
-            rangen.Double(0.0f, nutrientValue);
-          totalNutrientLevel += locale[i][j][k].nutrientLevel;
-          locale[i][j][k].acetateLevel =
-            rangen.Double(0.0f, acetateValue);
-          totalAcetateLevel += locale[i][j][k].acetateLevel;
-        }
-      break;
-
-    default:
-      throw invalid_argument("Error: Unknown randomiseType.");
-  }
-
-  temporalResolution = tempres;
-}
-
-
-void Environment::updateNutrient(const vector<int>& position,
-                                 double nutrientChange){
-  int i = position[0], j = position[1], k = position[2];
-
-  if (i >= 0 && i < ranges[0] && 
-    j >= 0 && j < ranges[1] && 
-    k >= 0 && k < ranges[2]){
-      locale[i][j][k].nutrientLevel += nutrientChange;
-      totalNutrientLevel += nutrientChange;
-  }
-}
-void Environment::updateAcetate(const vector<int>& location, double acetateChange) {
-  
-    if (location[0] < 0 || location[0] >= ranges[0] ||
-        location[1] < 0 || location[1] >= ranges[1] ||
-        location[2] < 0 || location[2] >= ranges[2]) {
-        return; 
-    }
-
-    locale[location[0]][location[1]][location[2]].acetateLevel += acetateChange;
-    totalAcetateLevel += acetateChange;
-}
-
-void Environment::updateCO2(double CO2Increase){
-  CO2Level += CO2Increase;
-}
-
-void Environment::updateTemporalResolution(const double tempResNew){
-  temporalResolution = tempResNew;
-}
-
-vector<int> Environment::getSize() const{
-  vector<int> range = {ranges[0], ranges[1], ranges[2]};
-  return range;
-}
-
-double Environment::getNutrientLevel(const vector<int>& position) const{
-
-  int i = position[0], j = position[1], k = position[2];
-
-  if (
-      i >= 0 && i < ranges[0] && 
-      j >= 0 && j < ranges[1] && 
-      k >= 0 && k < ranges[2]
-  ){
-      return locale[i][j][k].nutrientLevel;  
-  }
-
-  return 0.0f;
-}
-
-
-double Environment::getNutrientLevel() const{
-  return totalNutrientLevel;
-}
-
-
-double Environment::getAcetateLevel(const vector<int>& position) const{
-
-  int i = position[0], j = position[1], k = position[2];
-
-  if (i >= 0 && i < ranges[0] && 
-      j >= 0 && j < ranges[1] && 
-      k >= 0 && k < ranges[2])
-  if (i >= 0 && i < ranges[0] && j >= 0 &&
-    j < ranges[1] && k >= 0 && k < ranges[2])
-  {
-    return locale[i][j][k].acetateLevel;
-  }
-
-    return 0.0f;
-}
-
-
-double Environment::getAcetateLevel() const{
-  return totalAcetateLevel;
-}
-
-
-double Environment::getCO2Level(){
-  return CO2Level;
-}
-
-double Environment::getTemporalResolution(){
-  return temporalResolution;
-}
-
-
-
-void Environment::diffuse(){
-    auto nextLocale = locale;
-
-    int dx[] = {1, -1, 0, 0, 0, 0};
-    int dy[] = {0, 0, 1, -1, 0, 0};
-    int dz[] = {0, 0, 0, 0, 1, -1};
-
-    for (int i = 0; i < ranges[0]; ++i) {
-        for (int j = 0; j < ranges[1]; ++j) {
-            for (int k = 0; k < ranges[2]; ++k) {
-
-                double neighborNutrients = 0.0;
-                double neighborAcetate = 0.0;
-                int validNeighbors = 0;
-
-                for (int d = 0; d < 6; d++) {
-                    int nx = i + dx[d];
-                    int ny = j + dy[d];
-                    int nz = k + dz[d];
-
-                    if (nx >= 0 && nx < ranges[0] &&
-                        ny >= 0 && ny < ranges[1] &&
-                        nz >= 0 && nz < ranges[2]) {
-
-                        neighborNutrients += locale[nx][ny][nz].nutrientLevel;
-                        neighborAcetate += locale[nx][ny][nz].acetateLevel;
-                        validNeighbors++;
-                    }
-                }
-
-                if (validNeighbors > 0) {
-                    double avgNutrient = neighborNutrients / validNeighbors;
-                    double avgAcetate = neighborAcetate / validNeighbors;
-
-                    // Diffusion Rate: How fast stuff spreads (0.1 = 10% per step)
-                    double diffRate = 0.1;
-
-                    // Apply Diffusion to Nutrients (High -> Low)
-                    nextLocale[i][j][k].nutrientLevel += diffRate * (avgNutrient - locale[i][j][k].nutrientLevel);
-
-                    // Apply Diffusion AND Decay to Acetate
-                    // Decay Rate: 0.98 means 2% disappears naturally every step
-                    double decayedAcetate = locale[i][j][k].acetateLevel * 0.98;
-                    nextLocale[i][j][k].acetateLevel = decayedAcetate + diffRate * (avgAcetate - decayedAcetate);
-                }
-            }
-        }
-    }
-
-    locale = nextLocale;
-}
-
-
-double Environment::consumeNutrient(const vector<int>& pos, double amount) {
-    if (pos[0] < 0 || pos[0] >= ranges[0] ||
-        pos[1] < 0 || pos[1] >= ranges[1] ||
-        pos[2] < 0 || pos[2] >= ranges[2]) {
-        return 0.0;
-    }
-
-    double& currentLevel = locale[pos[0]][pos[1]][pos[2]].nutrientLevel;
-    
-    double actualConsumed = (currentLevel >= amount) ? amount : currentLevel;
-
-    currentLevel -= actualConsumed;
-    totalNutrientLevel -= actualConsumed;
-
-    return actualConsumed;
-}
+#include "Environment.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "Random.h"
+#include "TaskPool.h"
+using namespace std;
+
+Environment::Environment(int randomiseType, vector<int> rangesValue,
+                         double nutrientValue, double acetateValue,
+                         double tempres){
+  if (rangesValue.size() != 3)
+    throw invalid_argument("Error: rangesValue must be a 3-element vector.");
+  if (randomiseType != 0 && randomiseType != 1)
+    throw invalid_argument("Error: Unknown randomiseType.");
+
+  ranges = rangesValue;
+  extent = rangesValue;
+  locale.resize(size_t(ranges[0]) * ranges[1] * ranges[2]);
+
+  // seeds the shared rand() stream of the bacteria
+  RandomGenerator rangen;
+
+  // Every x plane is filled by one thread, from its own random stream for
+  // randomiseType 1, so the values do not depend on the number of threads.
+  // The totals are summed per plane and then added up in plane order
+  const unsigned int seed = RandomGenerator::runSeed();
+  vector<long double> nutrientPlane(ranges[0]), acetatePlane(ranges[0]);
+
+  parallelFor(ranges[0], [&](size_t first, size_t last){
+    for (int i = first; i < (int)last; i++){
+      RandomGenerator stream(seed, 0, i);
+      long double nutrientSum = 0.0f, acetateSum = 0.0f;
+
+      for (int j = 0; j < ranges[1]; j++)
+        for (int k = 0; k < ranges[2]; k++){
+          patch& p = cell(i, j, k);
+          if (randomiseType == 1){
+            p.nutrientLevel = stream.DoubleMT(0.0f, nutrientValue);
+            p.acetateLevel = stream.DoubleMT(0.0f, acetateValue);
+          }
+          else{
+            p.nutrientLevel = nutrientValue;
+            p.acetateLevel = acetateValue;
+          }
+          nutrientSum += p.nutrientLevel;
+          acetateSum += p.acetateLevel;
+        }
+
+      nutrientPlane[i] = nutrientSum;
+      acetatePlane[i] = acetateSum;
+    }
+  });
+
+  for (int i = 0; i < ranges[0]; i++){
+    totalNutrientLevel += nutrientPlane[i];
+    totalAcetateLevel += acetatePlane[i];
+  }
+
+  temporalResolution = tempres;
+}
+
+
+void Environment::updateNutrient(const vector<int>& position,
+                                 double nutrientChange){
+  int i = position[0] - origin[0], j = position[1] - origin[1],
+      k = position[2] - origin[2];
+
+  if (i >= 0 && i < ranges[0] && 
+    j >= 0 && j < ranges[1] && 
+    k >= 0 && k < ranges[2]){
+      cell(i, j, k).nutrientLevel += nutrientChange;
+      totalNutrientLevel += nutrientChange;
+  }
+}
+void Environment::updateAcetate(const vector<int>& location, double acetateChange) {
+  
+    int i = location[0] - origin[0], j = location[1] - origin[1],
+        k = location[2] - origin[2];
+
+    if (i < 0 || i >= ranges[0] ||
+        j < 0 || j >= ranges[1] ||
+        k < 0 || k >= ranges[2]) {
+        return; 
+    }
+
+    cell(i, j, k).acetateLevel += acetateChange;
+    totalAcetateLevel += acetateChange;
+}
+
+void Environment::updateCO2(double CO2Increase){
+  CO2Level += CO2Increase;
+}
+
+void Environment::updateTemporalResolution(const double tempResNew){
+  temporalResolution = tempResNew;
+}
+
+vector<int> Environment::getSize() const{
+  vector<int> range = {ranges[0], ranges[1], ranges[2]};
+  return range;
+}
+
+vector<int> Environment::getOrigin() const{
+  return origin;
+}
+
+vector<int> Environment::getExtent() const{
+  return extent;
+}
+
+double Environment::getNutrientLevel(const vector<int>& position) const{
+
+  int i = position[0] - origin[0], j = position[1] - origin[1],
+      k = position[2] - origin[2];
+
+  if (
+      i >= 0 && i < ranges[0] && 
+      j >= 0 && j < ranges[1] && 
+      k >= 0 && k < ranges[2]
+  ){
+      return cell(i, j, k).nutrientLevel;  
+  }
+
+  return 0.0f;
+}
+
+
+double Environment::getNutrientLevel() const{
+  return totalNutrientLevel;
+}
+
+
+double Environment::getAcetateLevel(const vector<int>& position) const{
+
+  int i = position[0] - origin[0], j = position[1] - origin[1],
+      k = position[2] - origin[2];
+
+  if (i >= 0 && i < ranges[0] && 
+      j >= 0 && j < ranges[1] && 
+      k >= 0 && k < ranges[2])
+  if (i >= 0 && i < ranges[0] && j >= 0 &&
+    j < ranges[1] && k >= 0 && k < ranges[2])
+  {
+    return cell(i, j, k).acetateLevel;
+  }
+
+    return 0.0f;
+}
+
+
+double Environment::getAcetateLevel() const{
+  return totalAcetateLevel;
+}
+
+
+void Environment::recordDeath(const vector<int>& location, double remains){
+  if (deathCount.empty()){
+    size_t cells = size_t(ranges[0]) * ranges[1] * ranges[2];
+    deathCount.assign(cells, 0);
+    necromass.assign(cells, 0.0f);
+    deathColumns.assign(size_t(ranges[0]) * ranges[1], 0);
+  }
+
+  int i = min(max(location[0] - origin[0], 0), ranges[0] - 1);
+  int j = min(max(location[1] - origin[1], 0), ranges[1] - 1);
+  int k = min(max(location[2] - origin[2], 0), ranges[2] - 1);
+  size_t n = index(i, j, k);
+
+  deathCount[n]++;
+  necromass[n] += remains;
+  deathColumns[size_t(i) * ranges[1] + j]++;
+}
+
+unsigned int Environment::getDeathCount(const vector<int>& position) const{
+  int i = position[0] - origin[0], j = position[1] - origin[1],
+      k = position[2] - origin[2];
+
+  if (deathCount.empty() ||
+      i < 0 || i >= ranges[0] || j < 0 || j >= ranges[1] ||
+      k < 0 || k >= ranges[2])
+    return 0;
+
+  return deathCount[index(i, j, k)];
+}
+
+double Environment::getNecromass(const vector<int>& position) const{
+  int i = position[0] - origin[0], j = position[1] - origin[1],
+      k = position[2] - origin[2];
+
+  if (necromass.empty() ||
+      i < 0 || i >= ranges[0] || j < 0 || j >= ranges[1] ||
+      k < 0 || k >= ranges[2])
+    return 0.0f;
+
+  return necromass[index(i, j, k)];
+}
+
+double Environment::getCO2Level(){
+  return CO2Level;
+}
+
+double Environment::getTemporalResolution(){
+  return temporalResolution;
+}
+
+
+
+void Environment::diffuse(){
+    // the next state goes to buffer, every patch of it is written
+    if (buffer.size() != locale.size())
+        buffer.resize(locale.size());
+    if (trackGradients && gradients.size() != locale.size())
+        gradients.resize(locale.size());
+
+    const int dx[] = {1, -1, 0, 0, 0, 0};
+    const int dy[] = {0, 0, 1, -1, 0, 0};
+    const int dz[] = {0, 0, 0, 0, 1, -1};
+
+    auto plane = [&](size_t plane){
+        const int i = plane;
+        for (int j = 0; j < ranges[1]; ++j) {
+            for (int k = 0; k < ranges[2]; ++k) {
+
+                const patch& current = cell(i, j, k);
+
+                double neighborNutrients = 0.0;
+                double neighborAcetate = 0.0;
+                int validNeighbors = 0;
+
+                // neighbour values, the patch's own where there is none
+                double nutrientAt[6], acetateAt[6];
+
+                for (int d = 0; d < 6; d++) {
+                    int nx = i + dx[d];
+                    int ny = j + dy[d];
+                    int nz = k + dz[d];
+
+                    if (nx >= 0 && nx < ranges[0] &&
+                        ny >= 0 && ny < ranges[1] &&
+                        nz >= 0 && nz < ranges[2]) {
+
+                        nutrientAt[d] = cell(nx, ny, nz).nutrientLevel;
+                        acetateAt[d] = cell(nx, ny, nz).acetateLevel;
+                        neighborNutrients += nutrientAt[d];
+                        neighborAcetate += acetateAt[d];
+                        validNeighbors++;
+                    }
+                    else {
+                        nutrientAt[d] = current.nutrientLevel;
+                        acetateAt[d] = current.acetateLevel;
+                    }
+                }
+
+                if (trackGradients) {
+                    gradient& g = gradients[index(i, j, k)];
+                    for (int axis = 0; axis < 3; axis++) {
+                        g.nutrient[axis] = 0.5 * (nutrientAt[2 * axis] - nutrientAt[2 * axis + 1]);
+                        g.acetate[axis] = 0.5 * (acetateAt[2 * axis] - acetateAt[2 * axis + 1]);
+                    }
+                }
+
+                patch& next = buffer[index(i, j, k)];
+                next = current;
+
+                if (validNeighbors > 0) {
+                    double avgNutrient = neighborNutrients / validNeighbors;
+                    double avgAcetate = neighborAcetate / validNeighbors;
+
+                    // Diffusion Rate: How fast stuff spreads (0.1 = 10% per step)
+                    double diffRate = 0.1;
+
+                    // Apply Diffusion to Nutrients (High -> Low)
+                    next.nutrientLevel += diffRate * (avgNutrient - current.nutrientLevel);
+
+                    // Apply Diffusion AND Decay to Acetate
+                    // Decay Rate: 0.98 means 2% disappears naturally every step
+                    double decayedAcetate = current.acetateLevel * 0.98;
+                    next.acetateLevel = decayedAcetate + diffRate * (avgAcetate - decayedAcetate);
+                }
+            }
+        }
+    };
+
+    // planes only read locale and write their own part of buffer
+    if (tasks != nullptr)
+        tasks->run(ranges[0], plane);
+    else
+        for (int i = 0; i < ranges[0]; ++i)
+            plane(i);
+
+    locale.swap(buffer);
+}
+
+
+double Environment::consumeNutrient(const vector<int>& pos, double amount) {
+    int i = pos[0] - origin[0], j = pos[1] - origin[1], k = pos[2] - origin[2];
+
+    if (i < 0 || i >= ranges[0] ||
+        j < 0 || j >= ranges[1] ||
+        k < 0 || k >= ranges[2]) {
+        return 0.0;
+    }
+
+    double& currentLevel = cell(i, j, k).nutrientLevel;
+    
+    double actualConsumed = (currentLevel >= amount) ? amount : currentLevel;
+
+    currentLevel -= actualConsumed;
+    totalNutrientLevel -= actualConsumed;
+
+    return actualConsumed;
+}
+
+
+uint64_t Environment::checksum(long double& nutrientSum,
+                               long double& acetateSum) const {
+    // locale is stored in i, j, k order
+    return checksum(locale.data(), locale.size(), nutrientSum, acetateSum);
+}
+
+
+uint64_t Environment::checksum(const patch* patches, size_t count,
+                               long double& nutrientSum,
+                               long double& acetateSum) {
+    // FNV-1a over the bit patterns of both values of every patch
+    uint64_t hash = 14695981039346656037ull;
+    nutrientSum = 0.0;
+    acetateSum = 0.0;
+
+    for (size_t n = 0; n < count; ++n) {
+        const patch& p = patches[n];
+        nutrientSum += p.nutrientLevel;
+        acetateSum += p.acetateLevel;
+
+        uint64_t bits[2];
+        memcpy(&bits[0], &p.nutrientLevel, sizeof(double));
+        memcpy(&bits[1], &p.acetateLevel, sizeof(double));
+        for (uint64_t word : bits) {
+            hash ^= word;
+            hash *= 1099511628211ull;
+        }
+    }
+
+    return hash;
+}
+
+
+void Environment::copyFields(vector<float>& nutrient, vector<float>& acetate,
+                             int firstPlane, int planes) const {
+    if (planes < 0)
+        planes = ranges[2] - firstPlane;
+    nutrient.resize(size_t(ranges[0]) * ranges[1] * planes);
+    acetate.resize(nutrient.size());
+
+    size_t n = 0;
+    for (int i = 0; i < ranges[0]; ++i)
+      for (int j = 0; j < ranges[1]; ++j)
+        for (int k = firstPlane; k < firstPlane + planes; ++k, ++n) {
+            nutrient[n] = cell(i, j, k).nutrientLevel;
+            acetate[n] = cell(i, j, k).acetateLevel;
+        }
+}
+
+
+void Environment::projectFields(vector<float>& nutrient,
+                                vector<float>& acetate) const {
+    nutrient.resize(size_t(ranges[0]) * ranges[1]);
+    acetate.resize(nutrient.size());
+
+    size_t n = 0;
+    for (int i = 0; i < ranges[0]; ++i)
+      for (int j = 0; j < ranges[1]; ++j, ++n) {
+            double nutrientSum = 0.0, acetateSum = 0.0;
+            for (int k = 0; k < ranges[2]; ++k) {
+                nutrientSum += cell(i, j, k).nutrientLevel;
+                acetateSum += cell(i, j, k).acetateLevel;
+            }
+            nutrient[n] = nutrientSum / ranges[2];
+            acetate[n] = acetateSum / ranges[2];
+        }
+}
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <stdexcept>
+#include "FieldPyramid.h"
+using namespace std;
+
+
+FieldPyramid::FieldPyramid(const ExportSettings& settingsValue,
+                           int nxValue, int nyValue, int nzValue)
+    : settings(settingsValue), nx(nxValue), ny(nyValue), nz(nzValue)
+{
+    if (settings.levels.empty())
+        throw invalid_argument("Error: field export needs at least one level.");
+
+    // levels stop once the grid is down to a single cell, a deeper one
+    // would be a copy of the last one under the wrong name
+    int depth = 0;
+    for (int x = nx, y = ny, z = nz; x > 1 || y > 1 || z > 1; depth++){
+        x = (x + 1) / 2;
+        y = (y + 1) / 2;
+        z = (z + 1) / 2;
+    }
+    deepest = *max_element(settings.levels.begin(), settings.levels.end());
+
+    for (int n : settings.levels){
+        if (n < 0)
+            throw invalid_argument("Error: pyramid levels start at 0.");
+        if (n > depth)
+            throw invalid_argument("Error: level " + to_string(n) + " is deeper"
+                                   " than the last level of the grid, " +
+                                   to_string(depth) + ".");
+
+        string filename = settings.basename + "-L" + to_string(n) + ".csv";
+        files.emplace_back(filename);
+        if (!files.back().is_open())
+            throw runtime_error("Could not open " + filename + " for writing.");
+
+        files.back() << "Step,X,Y,Z,Nutrient,Acetate\n";
+    }
+}
+
+
+int FieldPyramid::slicePlane() const
+{
+    return settings.zSlice < 0 ? nz / 2 : min(settings.zSlice, nz - 1);
+}
+
+
+void FieldPyramid::slab(int& firstPlane, int& planes) const
+{
+    firstPlane = (slicePlane() >> deepest) << deepest;
+    planes = min(firstPlane + (1 << deepest), nz) - firstPlane;
+}
+
+
+FieldPyramid::level FieldPyramid::downsample(const level& finer)
+{
+    level coarser;
+    coarser.nx = (finer.nx + 1) / 2;
+    coarser.ny = (finer.ny + 1) / 2;
+    coarser.nz = (finer.nz + 1) / 2;
+
+    size_t cells = size_t(coarser.nx) * coarser.ny * coarser.nz;
+    coarser.nutrient.assign(cells, 0.0f);
+    coarser.acetate.assign(cells, 0.0f);
+
+    for (int i = 0; i < coarser.nx; i++)
+      for (int j = 0; j < coarser.ny; j++)
+        for (int k = 0; k < coarser.nz; k++){
+            double nutrient = 0.0, acetate = 0.0;
+            int count = 0;
+
+            for (int a = 2 * i; a < min(2 * i + 2, finer.nx); a++)
+              for (int b = 2 * j; b < min(2 * j + 2, finer.ny); b++)
+                for (int c = 2 * k; c < min(2 * k + 2, finer.nz); c++){
+                    size_t n = finer.index(a, b, c);
+                    nutrient += finer.nutrient[n];
+                    acetate += finer.acetate[n];
+                    count++;
+                }
+
+            size_t n = coarser.index(i, j, k);
+            coarser.nutrient[n] = nutrient / count;
+            coarser.acetate[n] = acetate / count;
+        }
+
+    return coarser;
+}
+
+
+void FieldPyramid::write(unsigned long int step, level fields, int firstPlane)
+{
+    levels.resize(1);
+    levels[0] = std::move(fields);
+    while ((int)levels.size() <= deepest)
+        levels.push_back(downsample(levels.back()));
+
+    for (size_t f = 0; f < files.size(); f++){
+        const int depth = settings.levels[f];
+        const level& l = levels[depth];
+        ofstream& file = files[f];
+
+        if (settings.view == ExportSettings::volume){
+            for (int i = 0; i < l.nx; i++)
+              for (int j = 0; j < l.ny; j++)
+                for (int k = 0; k < l.nz; k++){
+                    size_t n = l.index(i, j, k);
+                    file << step << "," << i << "," << j << "," << k << ","
+                         << l.nutrient[n] << "," << l.acetate[n] << "\n";
+                }
+            continue;
+        }
+
+        // the slice is given at level 0 and scaled down with the level,
+        // local is its plane within the slab that was built
+        const int k = slicePlane() >> depth;
+        const int local = k - (firstPlane >> depth);
+
+        for (int i = 0; i < l.nx; i++)
+          for (int j = 0; j < l.ny; j++){
+              double nutrientValue = 0.0, acetateValue = 0.0;
+
+              if (settings.view == ExportSettings::projection){
+                  for (int z = 0; z < l.nz; z++){
+                      nutrientValue += l.nutrient[l.index(i, j, z)];
+                      acetateValue += l.acetate[l.index(i, j, z)];
+                  }
+                  nutrientValue /= l.nz;
+                  acetateValue /= l.nz;
+              }
+              else{
+                  nutrientValue = l.nutrient[l.index(i, j, local)];
+                  acetateValue = l.acetate[l.index(i, j, local)];
+              }
+
+              file << step << "," << i << "," << j << ","
+                   << (settings.view == ExportSettings::projection ? -1 : k)
+                   << "," << nutrientValue << "," << acetateValue << "\n";
+          }
+    }
+}
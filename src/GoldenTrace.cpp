@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include "GoldenTrace.h"
+using namespace std;
+
+
+void GoldenTrace::write(const string& filename) const
+{
+    ofstream file(filename);
+    if (!file.is_open())
+        throw runtime_error("Could not open " + filename + " for writing.");
+
+    file << "seed,numBacteria\n" << seed << "," << numBacteria << "\n";
+    file << "Step,AliveBacteria,TotalBacteria,NutrientSum,AcetateSum,"
+            "EnergySum,NetCO2,FieldHash\n";
+
+    // 21 significant digits is enough to read a long double back exactly
+    file << setprecision(21);
+    for (const StepState& s : steps)
+        file << s.step << "," << s.aliveBacteria << "," << s.totalBacteria
+             << "," << s.nutrientSum << "," << s.acetateSum << ","
+             << s.energySum << "," << s.CO2Level << ","
+             << hex << s.fieldHash << dec << "\n";
+}
+
+
+GoldenTrace GoldenTrace::read(const string& filename)
+{
+    ifstream file(filename);
+    if (!file.is_open())
+        throw runtime_error("Could not open " + filename + " for reading.");
+
+    GoldenTrace trace;
+    string line;
+
+    getline(file, line);
+    if (line != "seed,numBacteria")
+        throw runtime_error(filename + " is not a golden trace.");
+    getline(file, line);
+    if (sscanf(line.c_str(), "%u,%d", &trace.seed, &trace.numBacteria) != 2)
+        throw runtime_error(filename + " has a malformed header.");
+    getline(file, line);
+
+    while (getline(file, line))
+    {
+        if (line.empty())
+            continue;
+
+        vector<string> fields;
+        stringstream row(line);
+        string field;
+        while (getline(row, field, ','))
+            fields.push_back(field);
+        if (fields.size() != 8)
+            throw runtime_error(filename + " has a malformed row: " + line);
+
+        StepState s;
+        s.step = stoul(fields[0]);
+        s.aliveBacteria = stoul(fields[1]);
+        s.totalBacteria = stoul(fields[2]);
+        s.nutrientSum = strtold(fields[3].c_str(), nullptr);
+        s.acetateSum = strtold(fields[4].c_str(), nullptr);
+        s.energySum = strtold(fields[5].c_str(), nullptr);
+        s.CO2Level = strtod(fields[6].c_str(), nullptr);
+        s.fieldHash = stoull(fields[7], nullptr, 16);
+        trace.steps.push_back(s);
+    }
+
+    return trace;
+}
+
+
+// true if a and b are within tolerance of each other, relative to the
+// larger of the two
+static bool close(long double a, long double b, double tolerance)
+{
+    if (tolerance == 0)
+        return a == b;
+    return fabsl(a - b) <= tolerance * max(fabsl(a), fabsl(b));
+}
+
+
+long int GoldenTrace::firstDivergence(const GoldenTrace& other,
+                                      double tolerance, string& what) const
+{
+    size_t common = min(steps.size(), other.steps.size());
+
+    for (size_t i = 0; i < common; i++)
+    {
+        const StepState& a = steps[i];
+        const StepState& b = other.steps[i];
+
+        if (a.step != b.step)
+            what = "step number";
+        else if (!close(a.aliveBacteria, b.aliveBacteria, tolerance))
+            what = "alive bacteria";
+        else if (!close(a.totalBacteria, b.totalBacteria, tolerance))
+            what = "total bacteria";
+        else if (!close(a.nutrientSum, b.nutrientSum, tolerance))
+            what = "nutrient field";
+        else if (!close(a.acetateSum, b.acetateSum, tolerance))
+            what = "acetate field";
+        else if (!close(a.energySum, b.energySum, tolerance))
+            what = "energy sum";
+        else if (!close(a.CO2Level, b.CO2Level, tolerance))
+            what = "CO2 level";
+        else if (tolerance == 0 && a.fieldHash != b.fieldHash)
+            what = "field hash";
+        else
+            continue;
+
+        return i;
+    }
+
+    if (steps.size() != other.steps.size())
+    {
+        what = "number of steps";
+        return common;
+    }
+
+    return -1;
+}
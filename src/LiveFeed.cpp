@@ -0,0 +1,133 @@
+#include <cstring>
+#include <stdexcept>
+#include "LiveFeed.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+// stamps and the sequence counter are updated in place in the segment
+static_assert(atomic<uint64_t>::is_always_lock_free,
+              "the live feed needs lock-free 64 bit atomics");
+
+static atomic<uint64_t>& counterAt(unsigned char* address)
+{
+    return *reinterpret_cast<atomic<uint64_t>*>(address);
+}
+
+
+LiveFeed::LiveFeed(const string& nameValue, int nxValue, int nyValue,
+                   uint32_t maxBacteriaValue, uint32_t slotCountValue)
+    : name(nameValue), slotCount(slotCountValue), nx(nxValue), ny(nyValue),
+      maxBacteria(maxBacteriaValue)
+{
+    if (slotCount == 0 || nxValue <= 0 || nyValue <= 0)
+        throw invalid_argument("Error: live feed needs a slot and a slice.");
+
+    // slots are kept 8 byte aligned for the stamp
+    slotBytes = slotHeaderBytes + 2 * sizeof(float) * nx * ny
+              + 2 * sizeof(int32_t) * maxBacteria;
+    slotBytes = (slotBytes + 7) / 8 * 8;
+    bytes = headerBytes + slotBytes * slotCount;
+
+#ifdef _WIN32
+    throw runtime_error("Live feed needs POSIX shared memory.");
+#else
+    if (name.empty() || name[0] != '/')
+        name = "/" + name;
+
+    descriptor = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (descriptor < 0)
+        throw runtime_error("Could not create shared memory " + name);
+
+    if (ftruncate(descriptor, bytes) != 0){
+        close(descriptor);
+        shm_unlink(name.c_str());
+        throw runtime_error("Could not size shared memory " + name);
+    }
+
+    void* mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         descriptor, 0);
+    if (mapping == MAP_FAILED){
+        close(descriptor);
+        shm_unlink(name.c_str());
+        throw runtime_error("Could not map shared memory " + name);
+    }
+    base = static_cast<unsigned char*>(mapping);
+#endif
+
+    const uint32_t version = 1, unused = 0;
+    memcpy(base, "BIOSIMLF", 8);
+    memcpy(base + 8, &version, 4);
+    memcpy(base + 12, &slotCount, 4);
+    memcpy(base + 16, &nx, 4);
+    memcpy(base + 20, &ny, 4);
+    memcpy(base + 24, &maxBacteria, 4);
+    memcpy(base + 28, &unused, 4);
+    memcpy(base + 32, &slotBytes, 8);
+    counterAt(base + 40).store(0, memory_order_release);
+}
+
+
+LiveFeed::~LiveFeed()
+{
+#ifndef _WIN32
+    // readers that are attached keep their mapping, new ones cannot attach
+    if (base != nullptr)
+        munmap(base, bytes);
+    if (descriptor >= 0){
+        close(descriptor);
+        shm_unlink(name.c_str());
+    }
+#endif
+}
+
+
+unsigned char* LiveFeed::slot(uint64_t frame) const
+{
+    return base + headerBytes + (frame % slotCount) * slotBytes;
+}
+
+
+void LiveFeed::publish(unsigned long int timeStep, double timeElapsed,
+                       unsigned long int aliveBacteria,
+                       const vector<double>& nutrientSlice,
+                       const vector<double>& acetateSlice,
+                       const vector<int>& positions)
+{
+    const size_t cells = size_t(nx) * ny;
+    if (nutrientSlice.size() != cells || acetateSlice.size() != cells)
+        throw invalid_argument("Error: slice does not match the live feed.");
+
+    const uint64_t frame = published;
+    unsigned char* target = slot(frame);
+    atomic<uint64_t>& stamp = counterAt(target);
+
+    // odd stamp - readers discard anything they copy until it is even
+    stamp.store(2 * frame + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    const uint32_t alive = aliveBacteria;
+    const uint32_t count = min<size_t>(positions.size() / 2, maxBacteria);
+    memcpy(target + 8, &timeStep, 8);
+    memcpy(target + 16, &timeElapsed, 8);
+    memcpy(target + 24, &alive, 4);
+    memcpy(target + 28, &count, 4);
+
+    float* field = reinterpret_cast<float*>(target + slotHeaderBytes);
+    for (size_t n = 0; n < cells; n++){
+        field[n] = nutrientSlice[n];
+        field[cells + n] = acetateSlice[n];
+    }
+
+    int32_t* xy = reinterpret_cast<int32_t*>(field + 2 * cells);
+    for (size_t n = 0; n < 2 * size_t(count); n++)
+        xy[n] = positions[n];
+
+    stamp.store(2 * frame + 2, memory_order_release);
+
+    published++;
+    counterAt(base + 40).store(published, memory_order_release);
+}
@@ -0,0 +1,140 @@
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include "RunAnalytics.h"
+using namespace std;
+
+
+RunAnalytics::RunAnalytics(size_t capacityValue, double growthWindowValue)
+    : capacity(capacityValue), growthWindow(growthWindowValue)
+{
+    if (capacity < 2)
+        throw invalid_argument("Error: the series needs room for two samples.");
+    if (growthWindow <= 0)
+        throw invalid_argument("Error: the growth window must be positive.");
+    series.reserve(capacity);
+}
+
+
+void RunAnalytics::observe(const sample& current)
+{
+    if (observations == 0)
+        first = current;
+
+    // peak and time to peak
+    if (current.aliveBacteria > peakPopulation){
+        peakPopulation = current.aliveBacteria;
+        timeToPeak = current.timeElapsed;
+    }
+
+    // growth rate over the last growthWindow time units
+    if (current.aliveBacteria > 0){
+        window.emplace_back(current.timeElapsed, log(current.aliveBacteria));
+        while (window.size() > 2 &&
+               current.timeElapsed - window[1].first >= growthWindow)
+            window.pop_front();
+
+        const double span = current.timeElapsed - window.front().first;
+        if (span >= growthWindow)
+            growthRate = max(growthRate,
+                             (window.back().second - window.front().second) / span);
+    }
+    else
+        window.clear();
+
+    // nutrient half-life
+    const double half = first.nutrientLevel / 2;
+    if (nutrientHalfLife < 0 && observations > 0 && current.nutrientLevel <= half){
+        const double drop = last.nutrientLevel - current.nutrientLevel;
+        const double share = drop > 0 ? (last.nutrientLevel - half) / drop : 1.0;
+        nutrientHalfLife = last.timeElapsed
+                         + share * (current.timeElapsed - last.timeElapsed);
+    }
+
+    // downsampled series
+    if (observations % stride == 0){
+        if (series.size() == capacity){
+            size_t kept = 0;
+            for (size_t n = 0; n < series.size(); n += 2)
+                series[kept++] = series[n];
+            series.resize(kept);
+            stride *= 2;
+        }
+        if (observations % stride == 0)
+            series.push_back(current);
+    }
+
+    last = current;
+    observations++;
+}
+
+
+unsigned long int RunAnalytics::getPeakPopulation() const
+{
+    return peakPopulation;
+}
+
+
+double RunAnalytics::getTimeToPeak() const
+{
+    return timeToPeak;
+}
+
+
+double RunAnalytics::getGrowthRate() const
+{
+    return growthRate;
+}
+
+
+double RunAnalytics::getDoublingTime() const
+{
+    return growthRate > 0 ? log(2.0) / growthRate : -1.0f;
+}
+
+
+double RunAnalytics::getNutrientHalfLife() const
+{
+    return nutrientHalfLife;
+}
+
+
+const vector<RunAnalytics::sample>& RunAnalytics::getSeries() const
+{
+    return series;
+}
+
+
+void RunAnalytics::setThreadUtilisation(const vector<double>& shares)
+{
+    threadUtilisation = shares;
+}
+
+
+void RunAnalytics::write(const string& filename) const
+{
+    ofstream file(filename);
+    if (!file.is_open())
+        throw runtime_error("Could not open " + filename + " for writing.");
+
+    file << setprecision(10);
+    file << "# observations," << observations << "\n"
+         << "# finalTime," << last.timeElapsed << "\n"
+         << "# finalAlive," << last.aliveBacteria << "\n"
+         << "# finalTotal," << last.totalBacteria << "\n"
+         << "# peakAlive," << peakPopulation << "\n"
+         << "# timeToPeak," << timeToPeak << "\n"
+         << "# growthRate," << growthRate << "\n"
+         << "# doublingTime," << getDoublingTime() << "\n"
+         << "# nutrientHalfLife," << nutrientHalfLife << "\n"
+         << "# seriesStride," << stride << "\n";
+    for (size_t t = 0; t < threadUtilisation.size(); t++)
+        file << "# threadUtilisation" << t << "," << threadUtilisation[t] << "\n";
+
+    file << "TimeElapsed,AliveBacteria,TotalBacteria,NetCO2,TotalNutrient,TotalAcetate\n";
+    for (const sample& s : series)
+        file << s.timeElapsed << "," << s.aliveBacteria << ","
+             << s.totalBacteria << "," << s.CO2Level << ","
+             << s.nutrientLevel << "," << s.acetateLevel << "\n";
+}
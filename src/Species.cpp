@@ -1,223 +1,485 @@
-#include <cmath>
-#include <stdexcept>
-#include "Species.h"
-#include "Random.h"
-using namespace std;
-
-
-double Bacterium::temporalResolution = 1.0f;
-
-RandomGenerator ranGen;
-
-
-void Bacterium::setID(unsigned long int id)
-{
-    if ( bacteriaID !=0 )
-    {
-        throw runtime_error("Cannot modify value - Bacteria already registered");
-        return;
-    }
-
-    if ( id == 0 )
-    {
-        throw invalid_argument("Cannot set bacteriaID to 0");
-        return;
-    }
-
-    bacteriaID = id;
-}
-
-
-unsigned long int Bacterium::getID()
-{
-    return bacteriaID;
-}
-
-
-void Bacterium::updateTemporalResolution(double resolution) 
-{
-    if (resolution <= 0) 
-    {
-        throw invalid_argument("Temporal resolution must be a positive value.");
-    }
-
-    temporalResolution = resolution;
-}
-
-
-double Bacterium::getTemporalResolution() 
-{
-    return temporalResolution;
-}
-
-
-double Bacterium::getAcetateNearby(Environment* env) const
-{
-
-    double totalAcetate = 0.0f;
-    const vector<int> size = env->getSize();
-    
-    for (int x = max(0, position[0] - (int)proximity);
-         x <= min(size[0] - 1, position[0] + (int)proximity); ++x)
-      for (int y = max(0, position[1] - (int)proximity);
-           y <= min(size[1] - 1, position[1] + (int)proximity); ++y)
-        for (int z = max(0, position[2] - (int)proximity);
-             z <= min(size[2] - 1, position[2] + (int)proximity); ++z)
-        {
-            double distance = sqrt((x - position[0]) * (x - position[0])
-                                 + (y - position[1]) * (y - position[1])
-                                 + (z - position[2]) * (z - position[2]));
-
-            
-            if (distance <= proximity)
-                totalAcetate += env->getAcetateLevel({x, y, z});
-        }
-
-    return totalAcetate;
-}
-
-
-Bacterium::Bacterium(){
-	energy = 0.0f;
-	alive = 0;
-    updateTemporalResolution( 1.0f );
-}
-
-
-Bacterium::Bacterium( const vector<int> pos, double const energy_lvl){
-    alive = 1;
-    position = pos;
-    energy = ranGen.Double(energy_lvl);
-}
-
-
-bool Bacterium::operator==(const Bacterium& other) const{
-    return bacteriaID == other.bacteriaID;
-}
-
-
-void Bacterium::reproduce( Environment* surroundings , Bacterium& offspring)
-{
-    if (energy > reproductionEnergy)
-    {
-        offspring = Bacterium( position, energy / 2 );
-        energy /= 2;
-    }
-    else
-        offspring = Bacterium();
-}
-
-
-
-
-void Bacterium::eat(Environment* surroundings) {
-    double totalConsumed = 0.0;
-
-    
-    double centerRate = rateOfConsumption * 0.5;
-    totalConsumed += surroundings->consumeNutrient(position, centerRate);
-
-    double neighborRate = (rateOfConsumption * 0.5) / 6.0;
-    
-    int dx[] = {1, -1, 0, 0, 0, 0};
-    int dy[] = {0, 0, 1, -1, 0, 0};
-    int dz[] = {0, 0, 0, 0, 1, -1};
-
-    for (int i = 0; i < 6; i++) {
-        vector<int> neighborPos = {
-            position[0] + dx[i], 
-            position[1] + dy[i], 
-            position[2] + dz[i]
-        };
-        totalConsumed += surroundings->consumeNutrient(neighborPos, neighborRate);
-    }
-
-    energy += totalConsumed * energyPerNutrient;
-}
-
-
-void Bacterium::move(Environment* surroundings)
-{
-    const int range = movementSpeed;
-
-    int x_offset = ranGen.Int(-range, range);
-    int y_offset = ranGen.Int(-range, range);
-    int z_offset = ranGen.Int(-range, range);
-
-    position[0] += x_offset;
-    position[1] += y_offset;
-    position[2] += z_offset;
-
-    const int max_x = 100;
-    const int max_y = 100;
-    const int max_z = 100;
-
-    if (position[0] < 0){
-        position[0] = -position[0]; 
-    } else if (position[0] > max_x){
-        position[0] = max_x - (position[0] - max_x); 
-    }
-
-    if (position[1] < 0){
-        position[1] = -position[1]; 
-    } else if (position[1] > max_y){
-        position[1] = max_y - (position[1] - max_y); 
-    }
-
-    if (position[2] < 0){
-        position[2] = -position[2]; 
-    } else if (position[2] > max_z){
-        position[2] = max_z - (position[2] - max_z); 
-    }
-}
-
-
-void Bacterium::die(){
-    alive = 0;
-}
-
-
-void Bacterium::adapt( Environment* surroundings ){};
-
-double Bacterium::getEnergy(){
-    return energy;
-}
-
-
-
-bool Bacterium::canLive(Environment* surroundings) const {
-    if (energy <= minEnergy) return 0;
-
-    
-    if (getAcetateNearby(surroundings) > acidicLimit) {
-        return 0; 
-    }
-    
-
-    return 1;
-}
-
-
-bool Bacterium::isAlive() const
-{
-    return alive;
-}
-
-
-
-void Bacterium::live(Environment* surroundings, Bacterium& offspring) {
-    move(surroundings);
-    eat(surroundings);
-    adapt(surroundings);
-    reproduce(surroundings, offspring);
-    
-    energy -= livingEnergy;
-    surroundings->updateCO2(livingEnergy * CO2PerEnergy);
-
-    surroundings->updateAcetate(position, 1); 
-
-    if (!canLive(surroundings)) {
-        die();
-    }
-}
-
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include "Species.h"
+#include "Random.h"
+using namespace std;
+
+
+double Bacterium::temporalResolution = 1.0f;
+
+RandomGenerator ranGen;
+
+
+void Bacterium::setID(unsigned long int id)
+{
+    if ( bacteriaID !=0 )
+    {
+        throw runtime_error("Cannot modify value - Bacteria already registered");
+        return;
+    }
+
+    if ( id == 0 )
+    {
+        throw invalid_argument("Cannot set bacteriaID to 0");
+        return;
+    }
+
+    bacteriaID = id;
+}
+
+
+unsigned long int Bacterium::getID() const
+{
+    return bacteriaID;
+}
+
+
+void Bacterium::updateTemporalResolution(double resolution) 
+{
+    if (resolution <= 0) 
+    {
+        throw invalid_argument("Temporal resolution must be a positive value.");
+    }
+
+    temporalResolution = resolution;
+}
+
+
+double Bacterium::getTemporalResolution() 
+{
+    return temporalResolution;
+}
+
+
+double Bacterium::getAcetateNearby(Environment* env) const
+{
+
+    double totalAcetate = 0.0f;
+    const vector<int> size = env->getSize();
+    const vector<int> origin = env->getOrigin();
+    
+    for (int x = max(origin[0], position[0] - (int)proximity);
+         x <= min(origin[0] + size[0] - 1, position[0] + (int)proximity); ++x)
+      for (int y = max(origin[1], position[1] - (int)proximity);
+           y <= min(origin[1] + size[1] - 1, position[1] + (int)proximity); ++y)
+        for (int z = max(origin[2], position[2] - (int)proximity);
+             z <= min(origin[2] + size[2] - 1, position[2] + (int)proximity); ++z)
+        {
+            double distance = sqrt((x - position[0]) * (x - position[0])
+                                 + (y - position[1]) * (y - position[1])
+                                 + (z - position[2]) * (z - position[2]));
+
+            
+            if (distance <= proximity)
+                totalAcetate += env->getAcetateLevel({x, y, z});
+        }
+
+    return totalAcetate;
+}
+
+
+Bacterium::Bacterium(){
+	energy = 0.0f;
+	alive = 0;
+    updateTemporalResolution( 1.0f );
+}
+
+
+Bacterium::Bacterium( const vector<int> pos, double const energy_lvl){
+    alive = 1;
+    position = pos;
+    energy = ranGen.Double(energy_lvl);
+}
+
+
+Bacterium::Bacterium(vector<int> pos, double energy_lvl,
+                     RandomGenerator& generator){
+    alive = 1;
+    position = std::move(pos);
+    energy = generator.DoubleMT(energy_lvl);
+}
+
+
+Bacterium::Bacterium(const record& saved){
+    alive = 1;
+    bacteriaID = saved.id;
+    position = {saved.position[0], saved.position[1], saved.position[2]};
+    energy = saved.energy;
+}
+
+
+Bacterium::record Bacterium::save() const{
+    record saved;
+    saved.id = bacteriaID;
+    saved.position[0] = position[0];
+    saved.position[1] = position[1];
+    saved.position[2] = position[2];
+    saved.energy = energy;
+    return saved;
+}
+
+
+bool Bacterium::operator==(const Bacterium& other) const{
+    return bacteriaID == other.bacteriaID;
+}
+
+
+void Bacterium::reproduce( Environment* surroundings , Bacterium& offspring)
+{
+    if (energy > reproductionEnergy)
+    {
+        offspring = Bacterium( position, energy / 2 );
+        energy /= 2;
+    }
+    else
+        offspring = Bacterium();
+}
+
+
+
+
+void Bacterium::eat(Environment* surroundings) {
+    double totalConsumed = 0.0;
+
+    
+    double centerRate = rateOfConsumption * 0.5;
+    totalConsumed += surroundings->consumeNutrient(position, centerRate);
+
+    double neighborRate = (rateOfConsumption * 0.5) / 6.0;
+    
+    int dx[] = {1, -1, 0, 0, 0, 0};
+    int dy[] = {0, 0, 1, -1, 0, 0};
+    int dz[] = {0, 0, 0, 0, 1, -1};
+
+    for (int i = 0; i < 6; i++) {
+        vector<int> neighborPos = {
+            position[0] + dx[i], 
+            position[1] + dy[i], 
+            position[2] + dz[i]
+        };
+        totalConsumed += surroundings->consumeNutrient(neighborPos, neighborRate);
+    }
+
+    energy += totalConsumed * energyPerNutrient;
+}
+
+
+void Bacterium::move(Environment* surroundings)
+{
+    const int range = movementSpeed;
+
+    int x_offset = ranGen.Int(-range, range);
+    int y_offset = ranGen.Int(-range, range);
+    int z_offset = ranGen.Int(-range, range);
+
+    position[0] += x_offset;
+    position[1] += y_offset;
+    position[2] += z_offset;
+
+    // reflect at the walls of the chamber
+    const vector<int> extent = surroundings->getExtent();
+    const int max_x = extent[0] - 1;
+    const int max_y = extent[1] - 1;
+    const int max_z = extent[2] - 1;
+
+    if (position[0] < 0){
+        position[0] = -position[0]; 
+    } else if (position[0] > max_x){
+        position[0] = max_x - (position[0] - max_x); 
+    }
+
+    if (position[1] < 0){
+        position[1] = -position[1]; 
+    } else if (position[1] > max_y){
+        position[1] = max_y - (position[1] - max_y); 
+    }
+
+    if (position[2] < 0){
+        position[2] = -position[2]; 
+    } else if (position[2] > max_z){
+        position[2] = max_z - (position[2] - max_z); 
+    }
+}
+
+
+void Bacterium::die(deathCause reason){
+    alive = 0;
+    cause = reason;
+}
+
+
+void Bacterium::adapt( Environment* surroundings ){};
+
+double Bacterium::getEnergy(){
+    return energy;
+}
+
+
+
+bool Bacterium::canLive(Environment* surroundings) const {
+    if (energy <= minEnergy) return 0;
+
+    
+    if (getAcetateNearby(surroundings) > acidicLimit) {
+        return 0; 
+    }
+    
+
+    return 1;
+}
+
+
+bool Bacterium::isAlive() const
+{
+    return alive;
+}
+
+
+Bacterium::deathCause Bacterium::getDeathCause() const
+{
+    return static_cast<deathCause>(cause);
+}
+
+
+int Bacterium::getReach() const
+{
+    return reach<StandardStrain>();
+}
+
+
+
+void Bacterium::live(Environment* surroundings, Bacterium& offspring) {
+    move(surroundings);
+    eat(surroundings);
+    adapt(surroundings);
+    reproduce(surroundings, offspring);
+    
+    energy -= livingEnergy;
+    surroundings->updateCO2(livingEnergy * CO2PerEnergy);
+
+    surroundings->updateAcetate(position, 1); 
+
+    if (!canLive(surroundings)) {
+        die(energy <= minEnergy ? starvation : acidity);
+    }
+}
+
+
+
+// Offsets of the cells within proximity of a bacterium, in the order the
+// bounds-checked x, y, z loops visit them, so the acetate sum is the same
+// whichever way it is taken. Built at compile time for each strain
+template <class Strain>
+constexpr int stencilSize()
+{
+    const int reach = (int)Strain::proximity;
+    int size = 0;
+    for (int i = -reach; i <= reach; ++i)
+      for (int j = -reach; j <= reach; ++j)
+        for (int k = -reach; k <= reach; ++k)
+            if (i * i + j * j + k * k <= Strain::proximity * Strain::proximity)
+                size++;
+    return size;
+}
+
+template <class Strain>
+constexpr array<array<int, 3>, stencilSize<Strain>()> stencil()
+{
+    const int reach = (int)Strain::proximity;
+    array<array<int, 3>, stencilSize<Strain>()> offsets{};
+    int n = 0;
+    for (int i = -reach; i <= reach; ++i)
+      for (int j = -reach; j <= reach; ++j)
+        for (int k = -reach; k <= reach; ++k)
+            if (i * i + j * j + k * k <= Strain::proximity * Strain::proximity)
+            {
+                offsets[n][0] = i;
+                offsets[n][1] = j;
+                offsets[n][2] = k;
+                n++;
+            }
+    return offsets;
+}
+
+
+template <class Strain>
+void Bacterium::liveBlock(Environment* surroundings, Bacterium* block,
+                          size_t count, vector<Bacterium>& births,
+                          unsigned int seed, unsigned long int step,
+                          tally& totals)
+{
+    Environment& env = *surroundings;
+
+    // grid bounds and the neighbour stencil are hoisted out of the loop.
+    // Positions are global, patches are indexed relative to the origin
+    const int ox = env.origin[0], oy = env.origin[1], oz = env.origin[2];
+    const int nx = env.ranges[0], ny = env.ranges[1], nz = env.ranges[2];
+    const int max_x = env.extent[0] - 1, max_y = env.extent[1] - 1,
+              max_z = env.extent[2] - 1;
+
+    const int dx[] = {1, -1, 0, 0, 0, 0};
+    const int dy[] = {0, 0, 1, -1, 0, 0};
+    const int dz[] = {0, 0, 0, 0, 1, -1};
+
+    static constexpr auto nearby = stencil<Strain>();
+    constexpr int radius = (int)Strain::proximity;
+
+    constexpr int range = (int)Strain::movementSpeed;
+    constexpr double centerRate = Strain::rateOfConsumption * 0.5;
+    constexpr double neighborRate = (Strain::rateOfConsumption * 0.5) / 6.0;
+
+    // changes to the environment totals are summed up and applied once
+    double CO2Released = 0.0;
+    long double nutrientConsumed = 0.0, acetateReleased = 0.0;
+
+    for (size_t n = 0; n < count; ++n)
+    {
+        Bacterium& b = block[n];
+        int x = b.position[0], y = b.position[1], z = b.position[2];
+        KeyedGenerator stream(seed, 0, b.bacteriaID, step);
+
+        // move
+        int offset[3];
+        offset[0] = stream.Int(-range, range);
+        offset[1] = stream.Int(-range, range);
+        offset[2] = stream.Int(-range, range);
+
+        // one read of the gradients at the patch the bacterium is on
+        if constexpr (Strain::chemotactic)
+        {
+            const int i = x - ox, j = y - oy, k = z - oz;
+            if (!env.gradients.empty() && i >= 0 && i < nx &&
+                j >= 0 && j < ny && k >= 0 && k < nz)
+            {
+                const Environment::gradient& g = env.gradients[env.index(i, j, k)];
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    const double drift = Strain::nutrientTaxis * g.nutrient[axis]
+                                       - Strain::acetateTaxis * g.acetate[axis];
+                    if (stream.Double(1.0) < fabs(drift))
+                        offset[axis] = drift > 0 ? range : -range;
+                }
+            }
+        }
+
+        x += offset[0];
+        y += offset[1];
+        z += offset[2];
+
+        // reflect at the walls of the chamber
+        if (x < 0) x = -x; else if (x > max_x) x = max_x - (x - max_x);
+        if (y < 0) y = -y; else if (y > max_y) y = max_y - (y - max_y);
+        if (z < 0) z = -z; else if (z > max_z) z = max_z - (z - max_z);
+        x = min(max(x, 0), max_x);
+        y = min(max(y, 0), max_y);
+        z = min(max(z, 0), max_z);
+
+        b.position[0] = x;
+        b.position[1] = y;
+        b.position[2] = z;
+
+        // from here on x, y, z are local patch indices
+        x -= ox;
+        y -= oy;
+        z -= oz;
+
+        const bool inside = x >= 0 && x < nx && y >= 0 && y < ny &&
+                            z >= 0 && z < nz;
+
+        // eat
+        double totalConsumed = 0.0;
+
+        if (inside)
+        {
+            double& level = env.cell(x, y, z).nutrientLevel;
+            double consumed = (level >= centerRate) ? centerRate : level;
+            level -= consumed;
+            totalConsumed += consumed;
+        }
+
+        for (int d = 0; d < 6; d++)
+        {
+            int i = x + dx[d], j = y + dy[d], k = z + dz[d];
+            if (i < 0 || i >= nx || j < 0 || j >= ny || k < 0 || k >= nz)
+                continue;
+
+            double& level = env.cell(i, j, k).nutrientLevel;
+            double consumed = (level >= neighborRate) ? neighborRate : level;
+            level -= consumed;
+            totalConsumed += consumed;
+        }
+
+        nutrientConsumed += totalConsumed;
+        b.energy += totalConsumed * Strain::energyPerNutrient;
+
+        // reproduce - the newborn is built in place in births, with an
+        // energy of up to half the parent's like Bacterium(position, energy)
+        if (b.energy > Strain::reproductionEnergy)
+        {
+            const record newborn = {0, {b.position[0], b.position[1],
+                                        b.position[2]},
+                                    stream.Double(b.energy / 2)};
+            births.emplace_back(newborn);
+            b.energy /= 2;
+        }
+
+        // live
+        b.energy -= Strain::livingEnergy;
+        CO2Released += Strain::livingEnergy * Strain::CO2PerEnergy;
+
+        if (inside)
+        {
+            env.cell(x, y, z).acetateLevel += 1;
+            acetateReleased += 1;
+        }
+
+        // die - same checks as canLive()
+        if (b.energy <= Strain::minEnergy)
+        {
+            b.die(starvation);
+            continue;
+        }
+
+        double acetateNearby = 0.0;
+
+        // away from the faces of the grid the whole stencil is in range
+        if (x >= radius && x < nx - radius && y >= radius && y < ny - radius &&
+            z >= radius && z < nz - radius)
+        {
+            for (const auto& d : nearby)
+                acetateNearby += env.cell(x + d[0], y + d[1], z + d[2]).acetateLevel;
+        }
+        else
+        {
+            for (const auto& d : nearby)
+            {
+                int i = x + d[0], j = y + d[1], k = z + d[2];
+                if (i >= 0 && i < nx && j >= 0 && j < ny && k >= 0 && k < nz)
+                    acetateNearby += env.cell(i, j, k).acetateLevel;
+            }
+        }
+
+        if (acetateNearby > Strain::acidicLimit)
+            b.die(acidity);
+    }
+
+    totals.nutrientConsumed += nutrientConsumed;
+    totals.acetateReleased += acetateReleased;
+    totals.CO2Released += CO2Released;
+}
+
+
+// the strains the kernel is compiled for
+template void Bacterium::liveBlock<StandardStrain>(Environment*, Bacterium*,
+                                                   size_t, vector<Bacterium>&,
+                                                   unsigned int, unsigned long int,
+                                                   tally&);
+template void Bacterium::liveBlock<AcidTolerantStrain>(Environment*, Bacterium*,
+                                                       size_t, vector<Bacterium>&,
+                                                       unsigned int, unsigned long int,
+                                                       tally&);
+template void Bacterium::liveBlock<ChemotacticStrain>(Environment*, Bacterium*,
+                                                      size_t, vector<Bacterium>&,
+                                                      unsigned int, unsigned long int,
+                                                      tally&);
@@ -0,0 +1,153 @@
+#include <stdexcept>
+#include "TaskPool.h"
+using namespace std;
+
+
+TaskPool::TaskPool(unsigned int threadCount)
+{
+    if (threadCount == 0)
+        throw invalid_argument("Error: a task pool needs at least one thread.");
+
+    for (unsigned int t = 0; t < threadCount; t++)
+        workers.emplace_back(new worker);
+
+    since = chrono::steady_clock::now();
+    for (unsigned int t = 1; t < threadCount; t++)
+        threads.emplace_back(&TaskPool::work, this, t);
+}
+
+
+TaskPool::~TaskPool()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (thread& t : threads)
+        t.join();
+}
+
+
+unsigned int TaskPool::size() const
+{
+    return workers.size();
+}
+
+
+void TaskPool::run(size_t count, const function<void(size_t)>& task)
+{
+    if (count == 0)
+        return;
+
+    {
+        lock_guard<mutex> guard(lock);
+        current = &task;
+        pending = count;
+        error = nullptr;
+
+        // contiguous shares keep neighbouring tasks on one thread
+        const size_t n = workers.size();
+        for (size_t t = 0; t < n; t++){
+            lock_guard<mutex> share(workers[t]->lock);
+            for (size_t i = count * t / n; i < count * (t + 1) / n; i++)
+                workers[t]->tasks.push_back(i);
+        }
+        generation++;
+    }
+    wake.notify_all();
+
+    drain(0);
+
+    unique_lock<mutex> guard(lock);
+    done.wait(guard, [&]{ return pending == 0; });
+    current = nullptr;
+    if (error)
+        rethrow_exception(error);
+}
+
+
+vector<double> TaskPool::utilisation() const
+{
+    const double elapsed = chrono::duration<double, nano>(
+        chrono::steady_clock::now() - since).count();
+
+    vector<double> shares;
+    for (const unique_ptr<worker>& w : workers)
+        shares.push_back(elapsed > 0 ? w->busy / elapsed : 0.0);
+    return shares;
+}
+
+
+void TaskPool::resetUtilisation()
+{
+    for (unique_ptr<worker>& w : workers)
+        w->busy = 0;
+    since = chrono::steady_clock::now();
+}
+
+
+void TaskPool::work(unsigned int self)
+{
+    uint64_t seen = 0;
+    for (;;){
+        {
+            unique_lock<mutex> guard(lock);
+            wake.wait(guard, [&]{ return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+        drain(self);
+    }
+}
+
+
+void TaskPool::drain(unsigned int self)
+{
+    size_t index;
+    while (next(self, index)){
+        const auto start = chrono::steady_clock::now();
+        try{
+            (*current.load())(index);
+        }
+        catch (...){
+            lock_guard<mutex> guard(lock);
+            if (!error)
+                error = current_exception();
+        }
+        workers[self]->busy += chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now() - start).count();
+
+        if (--pending == 0){
+            lock_guard<mutex> guard(lock);
+            done.notify_all();
+        }
+    }
+}
+
+
+bool TaskPool::next(unsigned int self, size_t& index)
+{
+    {
+        worker& own = *workers[self];
+        lock_guard<mutex> guard(own.lock);
+        if (!own.tasks.empty()){
+            index = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    const size_t n = workers.size();
+    for (size_t offset = 1; offset < n; offset++){
+        worker& victim = *workers[(self + offset) % n];
+        lock_guard<mutex> guard(victim.lock);
+        if (!victim.tasks.empty()){
+            index = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,113 +1,209 @@
-import pygame
-import csv
-import sys
-import time
-
-# --- CONFIGURATION ---
-WIDTH, HEIGHT = 500, 500  # Window size
-GRID_SIZE = 50            # Simulation grid size (50x50)
-CELL_SIZE = WIDTH // GRID_SIZE
-FILENAME = "results/vis_data.csv" # Data file to read
-
-# --- COLORS ---
-BLACK = (0, 0, 0)
-GREEN = (0, 255, 0)       # Alive Bacteria
-RED = (255, 0, 0)         # Dead Bacteria
-YELLOW = (255, 255, 0)    # Nutrients
-BROWN = (139, 69, 19)     # Acetate
-
-def main():
-    pygame.init()
-    screen = pygame.display.set_mode((WIDTH, HEIGHT))
-    pygame.display.set_caption("SSPACE Bacteria Simulation (Top-Down View)")
-    clock = pygame.time.Clock()
-
-    print(f"Loading data from {FILENAME}...")
-    frames = {}
-    
-    try:
-        with open(FILENAME, 'r') as f:
-            reader = csv.reader(f)
-            # Format: Frame, Type (0=Nutrient, 1=Acetate, 2=Alive, 3=Dead), X, Y, Value
-            for row in reader:
-                if not row: continue
-                frame = int(row[0])
-                if frame not in frames: frames[frame] = []
-                frames[frame].append({
-                    'type': int(row[1]),
-                    'x': int(row[2]),
-                    'y': int(row[3]),
-                    'val': float(row[4])
-                })
-    except FileNotFoundError:
-        print("Error: Could not find 'results/vis_data.csv'. Run the C++ simulation first!")
-        sys.exit()
-
-    print(f"Loaded {len(frames)} frames. Starting visualization...")
-
-    frame_idx = 0
-    max_frame = max(frames.keys()) if frames else 0
-    running = True
-
-    while running:
-        for event in pygame.event.get():
-            if event.type == pygame.QUIT:
-                running = False
-
-        # 1. Clear Screen
-        screen.fill(BLACK)
-
-        # 2. Get data for current frame
-        if frame_idx in frames:
-            data = frames[frame_idx]
-            
-            # Draw Environment (Nutrients/Acetate) first
-            for item in data:
-                rect = (item['x'] * CELL_SIZE, item['y'] * CELL_SIZE, CELL_SIZE, CELL_SIZE)
-                
-                # --- FIX: DRAWING NUTRIENTS (Yellow) ---
-                # Check for > 1.0 (instead of 100) to see diffused nutrients
-                if item['type'] == 0 and item['val'] > 1.0: 
-                    
-                    # Boost intensity: Multiply by 5 to make faint 'fog' visible
-                    # (e.g., value 10 becomes alpha 50, value 50 becomes alpha 250)
-                    intensity = min(255, int(item['val'] * 5)) 
-                    
-                    s = pygame.Surface((CELL_SIZE, CELL_SIZE))
-                    s.set_alpha(intensity)
-                    s.fill(YELLOW)
-                    screen.blit(s, (item['x'] * CELL_SIZE, item['y'] * CELL_SIZE))
-
-                # --- FIX: DRAWING ACETATE (Brown) ---
-                elif item['type'] == 1 and item['val'] > 1.0:
-                    intensity = min(255, int(item['val'] * 10))
-                    s = pygame.Surface((CELL_SIZE, CELL_SIZE))
-                    s.set_alpha(intensity)
-                    s.fill(BROWN)
-                    screen.blit(s, (item['x'] * CELL_SIZE, item['y'] * CELL_SIZE))
-
-            # Draw Bacteria on top
-            for item in data:
-                center = (int(item['x'] * CELL_SIZE + CELL_SIZE/2), int(item['y'] * CELL_SIZE + CELL_SIZE/2))
-                if item['type'] == 2: # Alive
-                    pygame.draw.circle(screen, GREEN, center, CELL_SIZE // 2 - 1)
-                elif item['type'] == 3: # Dead
-                    pygame.draw.circle(screen, RED, center, CELL_SIZE // 2 - 1)
-
-        # Update Display
-        pygame.display.flip()
-        
-        # Advance Frame
-        if frame_idx < max_frame:
-            frame_idx += 1
-            # Check if we should hold the frame for a bit (speed control)
-            time.sleep(0.08) 
-        else:
-            # Loop back or stop
-            time.sleep(2)
-            frame_idx = 0
-
-    pygame.quit()
-
-if __name__ == "__main__":
-    main()
\ No newline at end of file
+import pygame
+import csv
+import sys
+import time
+import mmap
+import struct
+import array
+
+# --- CONFIGURATION ---
+WIDTH, HEIGHT = 500, 500  # Window size
+GRID_SIZE = 50            # Simulation grid size (50x50)
+CELL_SIZE = WIDTH // GRID_SIZE
+FILENAME = "results/vis_data.csv" # Data file to read
+
+# --- COLORS ---
+BLACK = (0, 0, 0)
+GREEN = (0, 255, 0)       # Alive Bacteria
+RED = (255, 0, 0)         # Dead Bacteria
+YELLOW = (255, 255, 0)    # Nutrients
+BROWN = (139, 69, 19)     # Acetate
+
+# --- LIVE FEED ---
+# Reader for the shared-memory ring buffer written by the simulation when it
+# is started with "--live <name>". The binary layout is documented in
+# include/LiveFeed.h.
+class LiveFeedReader:
+    HEADER_BYTES = 64
+    SLOT_HEADER_BYTES = 32
+
+    def __init__(self, name):
+        path = "/dev/shm/" + name.lstrip("/")
+        with open(path, "rb") as f:
+            self.buf = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, version, self.slot_count, self.nx, self.ny, self.max_bacteria, \
+            _, self.slot_bytes = struct.unpack_from("<8sIIIIIIQ", self.buf, 0)
+        if magic != b"BIOSIMLF" or version != 1:
+            raise ValueError(f"{path} is not a live feed")
+        self.last_frame = -1
+        self.dropped = 0
+
+    def sequence(self):
+        return struct.unpack_from("<Q", self.buf, 40)[0]
+
+    def latest(self):
+        """Returns the newest complete frame, or None if there is nothing new."""
+        published = self.sequence()
+        frame = published - 1
+        if frame <= self.last_frame:
+            return None
+
+        offset = self.HEADER_BYTES + (frame % self.slot_count) * self.slot_bytes
+        stamp = struct.unpack_from("<Q", self.buf, offset)[0]
+        if stamp != 2 * frame + 2:
+            return None  # still being written, try again next tick
+
+        cells = self.nx * self.ny
+        step, elapsed, alive, count = struct.unpack_from("<QdII", self.buf, offset + 8)
+        start = offset + self.SLOT_HEADER_BYTES
+        fields = array.array("f", self.buf[start:start + 8 * cells])
+        start += 8 * cells
+        positions = array.array("i", self.buf[start:start + 8 * count])
+
+        # the writer lapped us while copying, drop the frame
+        if struct.unpack_from("<Q", self.buf, offset)[0] != stamp:
+            return None
+
+        if self.last_frame >= 0:
+            self.dropped += frame - self.last_frame - 1
+        self.last_frame = frame
+
+        data = []
+        for n in range(cells):
+            x, y = divmod(n, self.ny)
+            if fields[n] > 1.0:
+                data.append({'type': 0, 'x': x, 'y': y, 'val': fields[n]})
+            if fields[cells + n] > 1.0:
+                data.append({'type': 1, 'x': x, 'y': y, 'val': fields[cells + n]})
+        for n in range(count):
+            data.append({'type': 2, 'x': positions[2 * n], 'y': positions[2 * n + 1], 'val': 1})
+        return step, alive, data
+
+
+def draw_frame(screen, data, cell_size):
+    # Draw Environment (Nutrients/Acetate) first
+    for item in data:
+        if item['type'] == 0 and item['val'] > 1.0:
+            intensity = min(255, int(item['val'] * 5))
+            s = pygame.Surface((cell_size, cell_size))
+            s.set_alpha(intensity)
+            s.fill(YELLOW)
+            screen.blit(s, (item['x'] * cell_size, item['y'] * cell_size))
+        elif item['type'] == 1 and item['val'] > 1.0:
+            intensity = min(255, int(item['val'] * 10))
+            s = pygame.Surface((cell_size, cell_size))
+            s.set_alpha(intensity)
+            s.fill(BROWN)
+            screen.blit(s, (item['x'] * cell_size, item['y'] * cell_size))
+
+    # Draw Bacteria on top
+    for item in data:
+        center = (int(item['x'] * cell_size + cell_size/2), int(item['y'] * cell_size + cell_size/2))
+        if item['type'] == 2: # Alive
+            pygame.draw.circle(screen, GREEN, center, max(1, cell_size // 2 - 1))
+        elif item['type'] == 3: # Dead
+            pygame.draw.circle(screen, RED, center, max(1, cell_size // 2 - 1))
+
+
+def main_live(name):
+    try:
+        feed = LiveFeedReader(name)
+    except FileNotFoundError:
+        print(f"Error: no live feed '{name}'. Start the simulation with --live {name} first!")
+        sys.exit()
+
+    cell_size = max(1, WIDTH // max(feed.nx, feed.ny))
+    pygame.init()
+    screen = pygame.display.set_mode((feed.nx * cell_size, feed.ny * cell_size))
+    clock = pygame.time.Clock()
+    print(f"Attached to live feed {name} ({feed.nx}x{feed.ny}).")
+
+    running = True
+    while running:
+        for event in pygame.event.get():
+            if event.type == pygame.QUIT:
+                running = False
+
+        frame = feed.latest()
+        if frame is not None:
+            step, alive, data = frame
+            pygame.display.set_caption(
+                f"SSPACE Bacteria Simulation (live) - step {step}, {alive} alive, {feed.dropped} frames dropped")
+            screen.fill(BLACK)
+            draw_frame(screen, data, cell_size)
+            pygame.display.flip()
+
+        clock.tick(30)
+
+    pygame.quit()
+
+
+def main():
+    pygame.init()
+    screen = pygame.display.set_mode((WIDTH, HEIGHT))
+    pygame.display.set_caption("SSPACE Bacteria Simulation (Top-Down View)")
+    clock = pygame.time.Clock()
+
+    print(f"Loading data from {FILENAME}...")
+    frames = {}
+    
+    try:
+        with open(FILENAME, 'r') as f:
+            reader = csv.reader(f)
+            # Format: Frame, Type (0=Nutrient, 1=Acetate, 2=Alive, 3=Dead), X, Y, Value
+            # (for Dead the value is the number of deaths in that column)
+            for row in reader:
+                if not row: continue
+                frame = int(row[0])
+                if frame not in frames: frames[frame] = []
+                frames[frame].append({
+                    'type': int(row[1]),
+                    'x': int(row[2]),
+                    'y': int(row[3]),
+                    'val': float(row[4])
+                })
+    except FileNotFoundError:
+        print("Error: Could not find 'results/vis_data.csv'. Run the C++ simulation first!")
+        sys.exit()
+
+    print(f"Loaded {len(frames)} frames. Starting visualization...")
+
+    frame_idx = 0
+    max_frame = max(frames.keys()) if frames else 0
+    running = True
+
+    while running:
+        for event in pygame.event.get():
+            if event.type == pygame.QUIT:
+                running = False
+
+        # 1. Clear Screen
+        screen.fill(BLACK)
+
+        # 2. Get data for current frame
+        if frame_idx in frames:
+            data = frames[frame_idx]
+            
+            draw_frame(screen, data, CELL_SIZE)
+
+        # Update Display
+        pygame.display.flip()
+        
+        # Advance Frame
+        if frame_idx < max_frame:
+            frame_idx += 1
+            # Check if we should hold the frame for a bit (speed control)
+            time.sleep(0.08) 
+        else:
+            # Loop back or stop
+            time.sleep(2)
+            frame_idx = 0
+
+    pygame.quit()
+
+if __name__ == "__main__":
+    # python visualiser.py [--live <name>]
+    if len(sys.argv) > 2 and sys.argv[1] == "--live":
+        main_live(sys.argv[2])
+    else:
+        main()
\ No newline at end of file